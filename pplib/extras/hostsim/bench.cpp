@@ -0,0 +1,386 @@
+/*
+ * pplib - a library for the Pico Held handheld
+ *
+ * Copyright (C) 2023 Daniel Kammer (daniel.kammer@web.de)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Sends a set of typical frames through the simulated bus and prints the
+// traffic and the bus time of each. The panel contents are saved as PPM
+// files into the directory given on the command line, and a few pixels of
+// each frame are compared with the colors sent.
+
+#include "hostsim.h"
+
+#include <Arduino.h>
+#include <hardware/lcd_if/lcdcom.h>
+#include <graphics/gbuffers.h>
+#include <graphics/colors.h>
+#include <graphics/primitives.h>
+#include <fonts/fonts.h>
+#include <fonts/fontfiles/f8x11.h>
+
+/* ========================== definitions ========================== */
+// max. number of pixels compared per frame
+#define BENCH_MAX_CHECKS 256
+
+// a pixel of the panel and the color (RGB565) it should show
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t color;
+} bench_check_t;
+
+/* ========================== global vars ========================== */
+const char* bench_dir = ".";
+int bench_failed = 0;
+
+// source of the strips
+gbuffer_t bench_strip_src;
+
+// pixels to be compared once the frame has been sent
+bench_check_t bench_checks[BENCH_MAX_CHECKS];
+int bench_num_checks = 0;
+
+// idle mode only shows the highest bit of each channel
+bool bench_idle = false;
+
+/* ====================== function definitions ===================== */
+// true if the panel pixel rgb shows the RGB565 color (as far as the bus
+// format and the mode of the panel keep its bits)
+bool bench_same_color(const uint8_t* rgb, uint16_t color) {
+  uint8_t sent[3] = { (uint8_t) ((color >> 8) & 0xf8), (uint8_t) ((color >> 3) & 0xfc), (uint8_t) ((color << 3) & 0xf8) };
+#ifdef LCD_BUS_RGB444
+  uint8_t mask[3] = { 0xf0, 0xf0, 0xf0 };
+#else
+  uint8_t mask[3] = { 0xf8, 0xfc, 0xf8 };
+#endif
+
+  for (int c = 0; c < 3; c++) {
+    if (bench_idle)
+      mask[c] = 0x80;
+    if ((rgb[c] & mask[c]) != (sent[c] & mask[c]))
+      return false;
+  }
+
+  return true;
+}  // bench_same_color
+
+void bench_expect(uint16_t x, uint16_t y, uint16_t color) {
+  if (bench_num_checks == BENCH_MAX_CHECKS)
+    return;
+
+  bench_checks[bench_num_checks++] = { x, y, color };
+}  // bench_expect
+
+// checks the corners and a few pixels in between of the rectangle x1, y1,
+// x2, y2 of the panel for a single color
+void bench_expect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint16_t color) {
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++)
+      bench_expect(x1 + (x2 - x1) * i / 3, y1 + (y2 - y1) * j / 3, color);
+}  // bench_expect_fill
+
+// same for the pixels of a buffer scaled up by scale (the buffer starts at
+// the top left corner of the panel)
+void bench_expect_buf(gbuffer16_t buf, uint8_t scale, coord_t x1, coord_t y1, coord_t x2, coord_t y2) {
+  color16_t* dat = gbuf_get_dat_ptr(buf);
+  uint16_t stride = gbuf_get_stride(buf);
+
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++) {
+      coord_t x = x1 + (x2 - x1) * i / 3;
+      coord_t y = y1 + (y2 - y1) * j / 3;
+      bench_expect(x, y, dat[x / scale + y / scale * stride]);
+    }
+}  // bench_expect_buf
+
+// (8 bit buffers are looked up in the current palette)
+void bench_expect_buf(gbuffer8_t buf, uint8_t scale, coord_t x1, coord_t y1, coord_t x2, coord_t y2) {
+  color8_t* dat = gbuf_get_dat_ptr(buf);
+  uint16_t stride = gbuf_get_stride(buf);
+  color_palette_t* pal = lcd_get_palette_ptr();
+
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++) {
+      coord_t x = x1 + (x2 - x1) * i / 3;
+      coord_t y = y1 + (y2 - y1) * j / 3;
+      bench_expect(x, y, pal[dat[x / scale + y / scale * stride]]);
+    }
+}  // bench_expect_buf
+
+// compares the expected pixels with the panel, returns the number of
+// mismatches
+int bench_check(const char* name) {
+  int bad = 0;
+
+  for (int i = 0; i < bench_num_checks; i++) {
+    bench_check_t* chk = &bench_checks[i];
+    uint8_t rgb[3];
+
+    hostsim_pixel(chk->x, chk->y, rgb);
+
+    if (!bench_same_color(rgb, chk->color)) {
+      if (bad == 0)
+        printf("%-28s pixel %d,%d shows %02x%02x%02x instead of %04x\n", name, chk->x, chk->y, rgb[0], rgb[1], rgb[2],
+               chk->color);
+      bad++;
+    }
+  }
+
+  if (bad > 0)
+    printf("%-28s %d of %d pixels differ from the frame sent\n", name, bad, bench_num_checks);
+
+  bench_num_checks = 0;
+
+  return bad;
+}  // bench_check
+
+// finishes a frame, saves the panel contents, prints the statistics and
+// compares the pixels expected
+void bench_frame(const char* name, lcd_error_t err) {
+  char file[256];
+
+  if (err == LCD_NOT_SUPPORTED) {
+    printf("%-28s not supported by this configuration\n", name);
+    bench_num_checks = 0;
+    return;
+  }
+
+  if (err != LCD_SUCCESS) {
+    printf("%-28s failed (%d)\n", name, err);
+    bench_failed++;
+    bench_num_checks = 0;
+    hostsim_frame(NULL);
+    return;
+  }
+
+  lcd_wait_ready();
+
+  snprintf(file, sizeof(file), "%s/%s.ppm", bench_dir, name);
+  hostsim_print(name, hostsim_frame(file));
+
+  if (bench_check(name) > 0)
+    bench_failed++;
+}  // bench_frame
+
+void bench_pattern(gbuffer16_t buf) {
+  uint16_t w = gbuf_get_width(buf);
+  uint16_t h = gbuf_get_height(buf);
+  color16_t* dat = gbuf_get_dat_ptr(buf);
+
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      dat[x + y * w] = rgb_col_888_565(x * 255 / w, y * 255 / h, (x ^ y) & 0xff);
+}  // bench_pattern
+
+void bench_pattern(gbuffer8_t buf) {
+  uint16_t w = gbuf_get_width(buf);
+  uint16_t h = gbuf_get_height(buf);
+  color8_t* dat = gbuf_get_dat_ptr(buf);
+
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      dat[x + y * w] = rgb_col_888_332(x * 255 / w, y * 255 / h, (x ^ y) & 0xff);
+
+  draw_rect(4, 4, w - 5, h - 5, 0xff, buf);
+  draw_line(4, 4, w - 5, h - 5, 0xff, buf);
+  font_write_string(8, 8, 0xff, (char*) "pplib host simulator", font_8x11, buf);
+}  // bench_pattern
+
+// copies the lines of the strip from the full frame
+void bench_strip(gbuffer_t strip, coord_t y_ofs) {
+  uint16_t w = gbuf_get_width(strip);
+
+  memcpy(gbuf_get_dat_ptr(strip), gbuf_get_dat_ptr(bench_strip_src) + y_ofs * w,
+         w * gbuf_get_height(strip) * sizeof(color_t));
+}  // bench_strip
+
+int main(int argc, char** argv) {
+  gbuffer16_t buf16, half16;
+  gbuffer8_t buf8, half8;
+
+  if (argc > 1)
+    bench_dir = argv[1];
+
+  if (lcd_init() != LCD_SUCCESS) {
+    printf("lcd_init failed\n");
+    return 1;
+  }
+  bench_frame("init", LCD_SUCCESS);
+
+  // the buffers are sized for the full resolution (large panels start with
+  // pixel doubling)
+  if (lcd_set_mode(16, LCD_FITTER_NONE) != LCD_SUCCESS) {
+    printf("lcd_set_mode failed\n");
+    return 1;
+  }
+
+  uint16_t w = lcd_get_screen_width();
+  uint16_t h = lcd_get_screen_height();
+
+  if (gbuf_alloc(&buf16, w, h) != BUF_SUCCESS || gbuf_alloc(&buf8, w, h) != BUF_SUCCESS ||
+      gbuf_alloc(&half16, w / 2, h / 2) != BUF_SUCCESS || gbuf_alloc(&half8, w / 2, h / 2) != BUF_SUCCESS) {
+    printf("out of memory\n");
+    return 1;
+  }
+
+  bench_pattern(buf16);
+  bench_pattern(buf8);
+  bench_pattern(half16);
+  bench_pattern(half8);
+
+  /* ---- swap chain ---- */
+#if LCD_COLORDEPTH == 16
+  bench_strip_src = buf16;
+  color_t swap_col = rgb_col_888_565(0, 160, 80);
+  uint16_t swap_565 = swap_col;
+#else
+  bench_strip_src = buf8;
+  color_t swap_col = rgb_col_888_332(0, 160, 80);
+  uint16_t swap_565 = lcd_get_palette_ptr()[swap_col];
+#endif
+
+  // the frame is started by the tearing signal after TEON
+  lcd_swapchain_t sc;
+  lcd_error_t err = lcd_set_mode(LCD_COLORDEPTH, LCD_FITTER_NONE);
+  if (err == LCD_SUCCESS)
+    err = lcd_swap_init(&sc, 2, true);
+  if (err == LCD_SUCCESS) {
+    gbuffer_t back = lcd_swap_get_back(&sc);
+    for (int i = 0; i < w * h; i++)
+      gbuf_get_dat_ptr(back)[i] = swap_col;
+
+    lcd_swap_wait_fence(&sc, lcd_swap_present(&sc));
+    bench_expect_fill(0, 0, w - 1, h - 1, swap_565);
+  }
+  bench_frame("swap_vsync", err);
+
+  // freeing the chain sends TEOFF, the next frame has to set the window
+  if (err == LCD_SUCCESS) {
+    lcd_swap_free(&sc);
+    bench_expect_buf(bench_strip_src, 1, 0, 0, w - 1, h - 1);
+    bench_frame("swap_freed", lcd_show_framebuffer(bench_strip_src));
+  }
+
+  // a mode change detaches the chain, nothing is queued any more
+  if (lcd_swap_init(&sc, 2, false) == LCD_SUCCESS) {
+    lcd_set_mode(16, LCD_FITTER_NONE);
+    lcd_swap_get_back(&sc);
+    if (lcd_swap_present(&sc) != 0) {
+      printf("%-28s frame queued on a detached swap chain\n", "swap_detached");
+      bench_failed++;
+    }
+    lcd_swap_free(&sc);
+  }
+
+  /* ---- full frames ---- */
+  err = lcd_set_mode(16, LCD_FITTER_NONE);
+  bench_expect_buf(buf16, 1, 0, 0, w - 1, h - 1);
+  bench_frame("full16", err != LCD_SUCCESS ? err : lcd_show_framebuffer(buf16));
+
+  err = lcd_set_mode(8, LCD_FITTER_NONE);
+  bench_expect_buf(buf8, 1, 0, 0, w - 1, h - 1);
+  bench_frame("full8_lut", err != LCD_SUCCESS ? err : lcd_show_framebuffer(buf8));
+
+  err = lcd_set_mode(16, LCD_FITTER_NEAREST);
+  bench_expect_buf(half16, 2, 0, 0, w - 1, h - 1);
+  bench_frame("nearest16", err != LCD_SUCCESS ? err : lcd_show_framebuffer(half16));
+
+  err = lcd_set_mode(8, LCD_FITTER_NEAREST);
+  bench_expect_buf(half8, 2, 0, 0, w - 1, h - 1);
+  bench_frame("nearest8_lut", err != LCD_SUCCESS ? err : lcd_show_framebuffer(half8));
+
+  /* ---- partial updates ---- */
+  if (lcd_set_mode(16, LCD_FITTER_NONE) != LCD_SUCCESS) {
+    printf("lcd_set_mode failed\n");
+    return 1;
+  }
+  lcd_rect_t rects[3] = { { 10, 10, 49, 49 }, { 100, 60, 179, 99 }, { w - 40, h - 40, w - 1, h - 1 } };
+  for (int i = 0; i < 3; i++)
+    bench_expect_buf(buf16, 1, rects[i].x1, rects[i].y1, rects[i].x2, rects[i].y2);
+  bench_frame("rects16", lcd_show_framebuffer_rects(buf16, rects, 3));
+
+  /* ---- strips ---- */
+  err = lcd_set_mode(LCD_COLORDEPTH, LCD_FITTER_NONE);
+  if (err == LCD_SUCCESS)
+    err = lcd_strip_init();
+  bench_expect_buf(bench_strip_src, 1, 0, 0, w - 1, h - 1);
+  bench_frame("strips", err != LCD_SUCCESS ? err : lcd_show_strips(bench_strip));
+  lcd_strip_free();
+
+  lcd_set_mode(16, LCD_FITTER_NONE);
+
+  /* ---- hardware scrolling ---- */
+  // The scroll commands follow a fill of the full window. The frame sent
+  // after them has to set the window again.
+  uint16_t blue = rgb_col_888_565(0, 0, 128);
+  uint16_t orange = rgb_col_888_565(255, 128, 0);
+
+  bench_expect_fill(0, 0, w - 1, h - 1, blue);
+  bench_frame("fill_screen", lcd_fill_screen(blue));
+
+  lcd_scroll_init(0, 0);
+  bench_expect_fill(0, 0, w - 1, h - 1, blue);
+  bench_frame("scroll", lcd_scroll_to(40));
+
+  lcd_scroll_to(0);
+  bench_expect_buf(buf16, 1, 0, 0, w - 1, h - 1);
+  bench_frame("scroll_back", lcd_show_framebuffer(buf16));
+
+  /* ---- direct drawing ---- */
+  bench_expect_fill(20, 20, w / 2, h / 2, orange);
+  bench_expect_buf(buf16, 1, w / 2 + 1, h / 2 + 1, w - 1, h - 1);
+  bench_frame("rect_fill", lcd_draw_rect_fill(20, 20, w / 2, h / 2, orange));
+
+  // (only the area below the text is checked)
+  font_write_string_lcd(10, 10, 0xffff, 0x0000, (char*) "pplib host simulator", font_8x11);
+  bench_expect_fill(20, 30, w / 2, h / 2, orange);
+  bench_frame("string_lcd", LCD_SUCCESS);
+
+  // converted through the palette in slices narrower than the buffer
+  bench_expect_buf(half8, 1, 0, 0, w / 2 - 1, h / 2 - 1);
+  bench_frame("draw_buf8", lcd_draw_buf(0, 0, half8));
+
+  /* ---- static screens ---- */
+  // The commands of lcd_static_begin follow a full frame, the first frame
+  // has to set the window again. The second frame is unchanged and
+  // therefore not sent. The lines shown are counted along the controller,
+  // whose lines may be screen columns, so only the middle of the screen is
+  // checked.
+  err = lcd_set_mode(8, LCD_FITTER_NONE);
+  bench_expect_buf(buf8, 1, 0, 0, w - 1, h - 1);
+  bench_frame("static_prev", err != LCD_SUCCESS ? err : lcd_show_framebuffer(buf8));
+  lcd_set_mode(16, LCD_FITTER_NONE);
+
+  lcd_static_begin(PHYS_SCREEN_HEIGHT / 4, PHYS_SCREEN_HEIGHT * 3 / 4 - 1, true);
+  bench_idle = true;
+  bench_expect_buf(buf16, 1, w / 4, h / 4, w * 3 / 4 - 1, h * 3 / 4 - 1);
+  bench_frame("static_first", lcd_show_framebuffer(buf16));
+  bench_expect_buf(buf16, 1, w / 4, h / 4, w * 3 / 4 - 1, h * 3 / 4 - 1);
+  bench_frame("static_same", lcd_show_framebuffer(buf16));
+  bench_idle = false;
+  lcd_static_end();
+
+  /* ---- views ---- */
+  // the middle of the frame, sent without being copied
+  gbuffer16_t view16;
+  gbuf_view(&view16, buf16, w / 4, h / 4, w / 2, h / 2);
+  bench_expect_buf(buf16, 1, w / 4, h / 4, w / 4 + w / 2 - 1, h / 4 + h / 2 - 1);
+  bench_frame("view_at", lcd_show_framebuffer_at(view16, w / 4, h / 4));
+
+  return bench_failed ? 1 : 0;
+}  // main
@@ -0,0 +1,54 @@
+/*
+ * pplib - a library for the Pico Held handheld
+ *
+ * Copyright (C) 2023 Daniel Kammer (daniel.kammer@web.de)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HOSTSIM_H
+#define HOSTSIM_H
+
+#include <stdint.h>
+
+/* ========================== definitions ========================== */
+// refresh rate of the simulated panel (TE signal)
+#ifndef HOSTSIM_REFRESH_HZ
+#define HOSTSIM_REFRESH_HZ 60
+#endif
+
+// bus traffic since the previous frame
+typedef struct {
+  uint32_t data_bytes;   /**< @brief bytes sent with DC high (pixels and parameters) */
+  uint32_t commands;     /**< @brief command bytes */
+  uint32_t windows;      /**< @brief address windows set (lcd_set_addr) */
+  uint64_t bus_cycles;   /**< @brief PIO cycles the bus was busy */
+  float bus_us;          /**< @brief bus time at the PIO clock */
+} hostsim_stats_t;
+
+/* =========================== functions =========================== */
+hostsim_stats_t hostsim_frame(const char* file);
+void hostsim_pixel(uint16_t x, uint16_t y, uint8_t* rgb);
+void hostsim_print(const char* name, hostsim_stats_t stats);
+
+/* ---------------- simulator internals (hostsim_*.cpp) ------------ */
+void hostsim_lcd_write(bool dc, uint8_t data);
+bool hostsim_lcd_te_enabled();
+void hostsim_run_idle();
+
+extern uint64_t hostsim_bus_cycles;
+extern double hostsim_cycle_ps;
+
+#endif  // HOSTSIM_H
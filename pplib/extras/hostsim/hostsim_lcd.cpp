@@ -0,0 +1,330 @@
+/*
+ * pplib - a library for the Pico Held handheld
+ *
+ * Copyright (C) 2023 Daniel Kammer (daniel.kammer@web.de)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// The display controller at the end of the 8080 bus. Only the commands
+// shared by the ST7789, ILI9341 and ILI9488 which change what is shown are
+// modelled, everything else is counted and ignored.
+
+#include "sdk/hostsim_sdk.h"
+#include "hostsim.h"
+
+#include <hardware/lcd_if/lcdcom.h>
+
+/* ========================== definitions ========================== */
+#define DCS_SWRESET   0x01
+#define DCS_PTLON     0x12
+#define DCS_NORON     0x13
+#define DCS_CASET     0x2A
+#define DCS_RASET     0x2B
+#define DCS_RAMWR     0x2C
+#define DCS_PTLAR     0x30
+#define DCS_VSCRDEF   0x33
+#define DCS_TEOFF     0x34
+#define DCS_TEON      0x35
+#define DCS_MADCTL    0x36
+#define DCS_VSCRSADD  0x37
+#define DCS_IDMOFF    0x38
+#define DCS_IDMON     0x39
+#define DCS_COLMOD    0x3A
+#define DCS_RAMWRC    0x3C
+
+#define MADCTL_MY     0x80
+#define MADCTL_MX     0x40
+#define MADCTL_MV     0x20
+
+/* ========================== global vars ========================== */
+uint8_t hsl_gram[PHYS_SCREEN_HEIGHT][PHYS_SCREEN_WIDTH][3];
+
+/* ---- controller state ---- */
+uint8_t hsl_cmd = 0;
+uint8_t hsl_param[6];
+uint8_t hsl_num_params = 0;
+
+uint16_t hsl_xs = 0, hsl_xe = PHYS_SCREEN_WIDTH - 1;
+uint16_t hsl_ys = 0, hsl_ye = PHYS_SCREEN_HEIGHT - 1;
+uint16_t hsl_col = 0, hsl_row = 0;
+
+uint8_t hsl_madctl = 0;
+uint8_t hsl_colmod = 0x55;
+bool hsl_te = false;
+
+uint16_t hsl_scroll_top = 0;
+uint16_t hsl_scroll_height = PHYS_SCREEN_HEIGHT;
+uint16_t hsl_scroll_start = 0;
+
+// partial display (lines outside the area are black) and idle mode (8 colors)
+bool hsl_partial = false;
+uint16_t hsl_partial_start = 0;
+uint16_t hsl_partial_end = PHYS_SCREEN_HEIGHT - 1;
+bool hsl_idle = false;
+
+// bytes of the pixel being assembled
+uint8_t hsl_pix[3];
+uint8_t hsl_pix_len = 0;
+
+hostsim_stats_t hsl_stats;
+uint64_t hsl_cycles_start = 0;
+
+/* ====================== function definitions ===================== */
+
+/* --------------------------- addressing -------------------------- */
+// maps the address counters to a GRAM position as set by MADCTL
+void hsl_map(uint16_t col, uint16_t row, uint16_t* gx, uint16_t* gy) {
+  bool mv = hsl_madctl & MADCTL_MV;
+  uint16_t cols = mv ? PHYS_SCREEN_HEIGHT : PHYS_SCREEN_WIDTH;
+  uint16_t rows = mv ? PHYS_SCREEN_WIDTH : PHYS_SCREEN_HEIGHT;
+
+  if (hsl_madctl & MADCTL_MX)
+    col = cols - 1 - col;
+  if (hsl_madctl & MADCTL_MY)
+    row = rows - 1 - row;
+
+  *gx = mv ? row : col;
+  *gy = mv ? col : row;
+}  // hsl_map
+
+// GRAM line shown on display line y
+uint16_t hsl_scroll(uint16_t y) {
+  if (y < hsl_scroll_top || y >= hsl_scroll_top + hsl_scroll_height || !hsl_scroll_height)
+    return y;
+
+  return hsl_scroll_top + (y - hsl_scroll_top + hsl_scroll_start - hsl_scroll_top + hsl_scroll_height) % hsl_scroll_height;
+}  // hsl_scroll
+
+void hsl_put_pixel(uint8_t r, uint8_t g, uint8_t b) {
+  uint16_t gx, gy;
+
+  hsl_map(hsl_col, hsl_row, &gx, &gy);
+  if (gx < PHYS_SCREEN_WIDTH && gy < PHYS_SCREEN_HEIGHT) {
+    hsl_gram[gy][gx][0] = r;
+    hsl_gram[gy][gx][1] = g;
+    hsl_gram[gy][gx][2] = b;
+  }
+
+  if (++hsl_col > hsl_xe) {
+    hsl_col = hsl_xs;
+    if (++hsl_row > hsl_ye)
+      hsl_row = hsl_ys;
+  }
+}  // hsl_put_pixel
+
+/* ---------------------------- memory ----------------------------- */
+void hsl_ram_data(uint8_t data) {
+  hsl_pix[hsl_pix_len++] = data;
+
+  switch (hsl_colmod & 0x07) {
+    case 0x03:  // 12 bit, two pixels in three bytes
+      if (hsl_pix_len < 3)
+        return;
+      hsl_put_pixel(hsl_pix[0] & 0xf0, (hsl_pix[0] << 4) & 0xf0, hsl_pix[1] & 0xf0);
+      hsl_put_pixel((hsl_pix[1] << 4) & 0xf0, hsl_pix[2] & 0xf0, (hsl_pix[2] << 4) & 0xf0);
+      break;
+    case 0x06:  // 18 bit, one byte per channel
+      if (hsl_pix_len < 3)
+        return;
+      hsl_put_pixel(hsl_pix[0] & 0xfc, hsl_pix[1] & 0xfc, hsl_pix[2] & 0xfc);
+      break;
+    default:  // 16 bit
+      if (hsl_pix_len < 2)
+        return;
+      {
+        uint16_t c = (hsl_pix[0] << 8) | hsl_pix[1];
+        hsl_put_pixel((c >> 8) & 0xf8, (c >> 3) & 0xfc, (c << 3) & 0xf8);
+      }
+      break;
+  }
+
+  hsl_pix_len = 0;
+}  // hsl_ram_data
+
+/* --------------------------- commands ---------------------------- */
+void hsl_command(uint8_t cmd) {
+  hsl_cmd = cmd;
+  hsl_num_params = 0;
+  hsl_pix_len = 0;
+
+  switch (cmd) {
+    case DCS_SWRESET:
+      hsl_madctl = 0;
+      hsl_colmod = 0x55;
+      hsl_te = false;
+      hsl_scroll_top = 0;
+      hsl_scroll_height = PHYS_SCREEN_HEIGHT;
+      hsl_scroll_start = 0;
+      hsl_partial = false;
+      hsl_idle = false;
+      break;
+    case DCS_CASET:
+      hsl_stats.windows++;
+      break;
+    case DCS_RAMWR:
+      hsl_col = hsl_xs;
+      hsl_row = hsl_ys;
+      break;
+    case DCS_TEOFF:
+      hsl_te = false;
+      break;
+    case DCS_TEON:
+      hsl_te = true;
+      break;
+    case DCS_PTLON:
+      hsl_partial = true;
+      break;
+    case DCS_NORON:
+      hsl_partial = false;
+      break;
+    case DCS_IDMOFF:
+      hsl_idle = false;
+      break;
+    case DCS_IDMON:
+      hsl_idle = true;
+      break;
+  }
+}  // hsl_command
+
+void hsl_parameter(uint8_t data) {
+  if (hsl_num_params < sizeof(hsl_param))
+    hsl_param[hsl_num_params] = data;
+  hsl_num_params++;
+
+  switch (hsl_cmd) {
+    case DCS_CASET:
+      if (hsl_num_params == 2)
+        hsl_xs = (hsl_param[0] << 8) | hsl_param[1];
+      if (hsl_num_params == 4)
+        hsl_xe = (hsl_param[2] << 8) | hsl_param[3];
+      break;
+    case DCS_RASET:
+      if (hsl_num_params == 2)
+        hsl_ys = (hsl_param[0] << 8) | hsl_param[1];
+      if (hsl_num_params == 4)
+        hsl_ye = (hsl_param[2] << 8) | hsl_param[3];
+      break;
+    case DCS_RAMWR:
+    case DCS_RAMWRC:
+      hsl_ram_data(data);
+      break;
+    case DCS_MADCTL:
+      hsl_madctl = data;
+      break;
+    case DCS_COLMOD:
+      hsl_colmod = data;
+      break;
+    case DCS_VSCRDEF:
+      if (hsl_num_params == 2)
+        hsl_scroll_top = (hsl_param[0] << 8) | hsl_param[1];
+      if (hsl_num_params == 4)
+        hsl_scroll_height = (hsl_param[2] << 8) | hsl_param[3];
+      break;
+    case DCS_PTLAR:
+      if (hsl_num_params == 2)
+        hsl_partial_start = (hsl_param[0] << 8) | hsl_param[1];
+      if (hsl_num_params == 4)
+        hsl_partial_end = (hsl_param[2] << 8) | hsl_param[3];
+      break;
+    case DCS_VSCRSADD:
+      if (hsl_num_params == 2)
+        hsl_scroll_start = (hsl_param[0] << 8) | hsl_param[1];
+      break;
+  }
+}  // hsl_parameter
+
+// called on every rising edge of WR
+void hostsim_lcd_write(bool dc, uint8_t data) {
+  if (dc) {
+    hsl_stats.data_bytes++;
+    hsl_parameter(data);
+  } else {
+    hsl_stats.commands++;
+    hsl_command(data);
+  }
+}  // hostsim_lcd_write
+
+bool hostsim_lcd_te_enabled() {
+  return hsl_te;
+}  // hostsim_lcd_te_enabled
+
+/* ---------------------------- capture ---------------------------- */
+// color the panel shows at (x, y), in the orientation set by MADCTL
+void hostsim_pixel(uint16_t x, uint16_t y, uint8_t* rgb) {
+  uint16_t gx, gy;
+
+  hsl_map(x, y, &gx, &gy);
+
+  for (int c = 0; c < 3; c++)
+    rgb[c] = 0;
+
+  if (gx >= PHYS_SCREEN_WIDTH || gy >= PHYS_SCREEN_HEIGHT)
+    return;
+
+  if (hsl_partial && (gy < hsl_partial_start || gy > hsl_partial_end))
+    return;
+
+  for (int c = 0; c < 3; c++)
+    rgb[c] = hsl_idle ? ((hsl_gram[hsl_scroll(gy)][gx][c] & 0x80) ? 0xff : 0) : hsl_gram[hsl_scroll(gy)][gx][c];
+}  // hostsim_pixel
+
+// writes what the panel shows as a binary PPM
+bool hsl_save_ppm(const char* file) {
+  bool mv = hsl_madctl & MADCTL_MV;
+  uint16_t width = mv ? PHYS_SCREEN_HEIGHT : PHYS_SCREEN_WIDTH;
+  uint16_t height = mv ? PHYS_SCREEN_WIDTH : PHYS_SCREEN_HEIGHT;
+
+  FILE* f = fopen(file, "wb");
+  if (!f)
+    return false;
+
+  fprintf(f, "P6\n%d %d\n255\n", width, height);
+
+  for (uint16_t y = 0; y < height; y++)
+    for (uint16_t x = 0; x < width; x++) {
+      uint8_t pix[3];
+
+      hostsim_pixel(x, y, pix);
+      fwrite(pix, 3, 1, f);
+    }
+
+  fclose(f);
+
+  return true;
+}  // hsl_save_ppm
+
+// Lets the hardware finish, optionally captures the panel and returns the
+// bus traffic since the previous call.
+hostsim_stats_t hostsim_frame(const char* file) {
+  hostsim_run_idle();
+
+  if (file && !hsl_save_ppm(file))
+    fprintf(stderr, "hostsim: could not write %s\n", file);
+
+  hostsim_stats_t stats = hsl_stats;
+  stats.bus_cycles = hostsim_bus_cycles - hsl_cycles_start;
+  stats.bus_us = stats.bus_cycles * hostsim_cycle_ps / 1e6;
+
+  memset(&hsl_stats, 0, sizeof(hsl_stats));
+  hsl_cycles_start = hostsim_bus_cycles;
+
+  return stats;
+}  // hostsim_frame
+
+void hostsim_print(const char* name, hostsim_stats_t stats) {
+  printf("%-28s %8u bytes %5u cmds %5u windows %10.1f us %8.1f fps\n", name, stats.data_bytes, stats.commands,
+         stats.windows, stats.bus_us, stats.commands > 0 ? 1e6 / stats.bus_us : 0.0);
+}  // hostsim_print
@@ -0,0 +1,1265 @@
+/*
+ * pplib - a library for the Pico Held handheld
+ *
+ * Copyright (C) 2023 Daniel Kammer (daniel.kammer@web.de)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// The hardware behind the LCD interface: the PIO state machines run the
+// programs of the library instruction by instruction, one PIO clock per
+// cycle. The DMA moves data as soon as its DREQ allows, i.e. it never is
+// the bottleneck. Interrupts are taken between two PIO cycles unless the
+// CPU already is in a handler.
+
+#include "sdk/hostsim_sdk.h"
+#include "hostsim.h"
+
+#include <hwcfg.h>
+
+/* ========================== definitions ========================== */
+#ifndef F_CPU
+#define F_CPU 133000000
+#endif
+
+#define HS_POLL_CYCLES    64          // PIO cycles run per poll of a register
+#define HS_MAX_IDLE_POLLS 10000000    // polls of an idle machine until deadlock
+
+#define HS_TE_PERIOD_PS   (1000000000000ull / HOSTSIM_REFRESH_HZ)
+#define HS_TE_VBLANK_PS   (HS_TE_PERIOD_PS / 10)
+
+/* ========================== global vars ========================== */
+uint64_t hostsim_bus_cycles = 0;
+double hostsim_cycle_ps = 1e12 / F_CPU;
+
+pio_hw_t hostsim_pio[2];
+dma_hw_t hostsim_dma;
+interp_hw_t hostsim_interp[2];
+
+/* ---- time and events ---- */
+uint64_t hs_now_ps = 0;
+uint64_t hs_te_next_ps = 0;
+bool hs_te_pending = false;
+void (*hs_te_callback)(void) = NULL;
+
+bool hs_event = false;
+uint hs_exception = 0;
+uint32_t hs_idle_polls = 0;
+
+irq_handler_t hs_irq_handler[32];
+bool hs_irq_enabled[32];
+
+/* ---- gpio ---- */
+uint8_t hs_gpio_func[32];
+uint32_t hs_gpio_out = 0;
+uint32_t hs_gpio_next = 0;
+
+/* ---- pio ---- */
+typedef struct {
+  bool claimed;
+  bool enabled;
+  pio_sm_config cfg;
+  uint8_t pc;
+  uint8_t delay;
+  uint32_t osr, isr, x, y;
+  uint8_t osr_count;    // bits shifted out, 32 = empty
+  uint8_t isr_count;    // bits shifted in
+  uint32_t tx[8];
+  uint8_t tx_level;
+  uint32_t rx[8];
+  uint8_t rx_level;
+  bool exec_pending;
+  uint16_t exec_instr;
+} hs_sm_t;
+
+typedef struct {
+  uint16_t imem[32];
+  uint32_t used;
+  uint32_t fdebug;
+  uint8_t irq;
+  hs_sm_t sm[NUM_PIO_STATE_MACHINES];
+} hs_pio_t;
+
+hs_pio_t hs_pio[2];
+
+/* ---- dma ---- */
+typedef struct {
+  bool claimed;
+  bool busy;
+  dma_channel_config cfg;
+  uintptr_t read;
+  uintptr_t write;
+  uint32_t count;
+  uint32_t reload;
+} hs_dma_t;
+
+hs_dma_t hs_dma[NUM_DMA_CHANNELS];
+uint32_t hs_dma_ints = 0;
+uint32_t hs_dma_inte0 = 0;
+
+int hs_sniff_chan = -1;
+uint32_t hs_sniff_acc = 0;
+
+/* ====================== function declarations ==================== */
+bool hs_cycle();
+bool hs_run(uint32_t cycles, bool* irq);
+void hs_poll();
+void hs_fatal(const char* msg);
+
+/* ====================== function definitions ===================== */
+
+/* ---------------------------- startup ---------------------------- */
+struct hs_init_t {
+  hs_init_t() {
+    for (int p = 0; p < 2; p++) {
+      hostsim_pio[p].fdebug.pio = p;
+      for (int n = 0; n < NUM_PIO_STATE_MACHINES; n++) {
+        hostsim_pio[p].txf[n].pio = hostsim_pio[p].rxf[n].pio = hostsim_pio[p].sm[n].instr.pio = p;
+        hostsim_pio[p].txf[n].sm = hostsim_pio[p].rxf[n].sm = hostsim_pio[p].sm[n].instr.sm = n;
+      }
+    }
+
+    for (int i = 0; i < 2; i++)
+      for (int lane = 0; lane < 3; lane++) {
+        hostsim_interp[i].pop[lane].interp = hostsim_interp[i].peek[lane].interp = i;
+        hostsim_interp[i].pop[lane].lane = hostsim_interp[i].peek[lane].lane = lane;
+      }
+
+    for (int i = 0; i < 32; i++)
+      hs_gpio_func[i] = GPIO_FUNC_NULL;
+
+    // the palette lookup passes addresses through a 32 bit PIO register
+    if ((uintptr_t) &hostsim_dma > 0xffffffffu)
+      fprintf(stderr, "hostsim: data above 4 GB, 8 bit frames need a build with -no-pie\n");
+  }
+} hs_init;
+
+void hs_fatal(const char* msg) {
+  fprintf(stderr, "hostsim: %s\n", msg);
+  exit(1);
+}  // hs_fatal
+
+/* ---------------------------- arduino ---------------------------- */
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
+
+void hs_te_update() {
+  while (hs_now_ps >= hs_te_next_ps) {
+    if (hs_te_callback && hostsim_lcd_te_enabled())
+      hs_te_pending = true;
+    hs_te_next_ps += HS_TE_PERIOD_PS;
+  }
+}  // hs_te_update
+
+int digitalRead(uint8_t pin) {
+  if (pin != PIN_LCD_TE)
+    return LOW;
+
+  // polling the tearing signal takes time even when nothing else happens
+  bool irq = false;
+  if (!hs_run(HS_POLL_CYCLES, &irq)) {
+    hs_now_ps += 1000000;
+    hs_te_update();
+  }
+
+  return hostsim_lcd_te_enabled() && (hs_now_ps % HS_TE_PERIOD_PS) < HS_TE_VBLANK_PS;
+}  // digitalRead
+
+void delay(unsigned long ms) {
+  delayMicroseconds(ms * 1000);
+}  // delay
+
+void delayMicroseconds(unsigned int us) {
+  uint64_t until = hs_now_ps + (uint64_t) us * 1000000;
+  bool irq = false;
+
+  // the hardware keeps running while the CPU waits
+  while (hs_now_ps < until && hs_run(HS_POLL_CYCLES, &irq))
+    ;
+
+  while (hs_now_ps < until) {
+    hs_now_ps = hs_te_next_ps < until ? hs_te_next_ps : until;
+    hs_te_update();
+    while (hs_run(HS_POLL_CYCLES, &irq))
+      ;
+  }
+}  // delayMicroseconds
+
+unsigned long millis() {
+  return hs_now_ps / 1000000000;
+}  // millis
+
+unsigned long micros() {
+  return hs_now_ps / 1000000;
+}  // micros
+
+void attachInterrupt(uint8_t pin, void (*callback)(void), int mode) {
+  if (pin == PIN_LCD_TE)
+    hs_te_callback = callback;
+}  // attachInterrupt
+
+void detachInterrupt(uint8_t pin) {
+  if (pin == PIN_LCD_TE)
+    hs_te_callback = NULL;
+}  // detachInterrupt
+
+/* ------------------------------ core ----------------------------- */
+// dispatches pending interrupts, returns true if a handler was called
+bool hs_dispatch() {
+  bool called = false;
+
+  if (hs_exception)
+    return false;
+
+  for (;;) {
+    irq_handler_t dma_handler = hs_irq_handler[DMA_IRQ_0];
+    if ((hs_dma_ints & hs_dma_inte0) && hs_irq_enabled[DMA_IRQ_0] && dma_handler) {
+      hs_exception = 16 + DMA_IRQ_0;
+      dma_handler();
+      hs_exception = 0;
+      called = true;
+      continue;
+    }
+
+    if (hs_te_pending) {
+      hs_te_pending = false;
+      if (hs_te_callback) {
+        hs_exception = 16 + IO_IRQ_BANK0;
+        hs_te_callback();
+        hs_exception = 0;
+        called = true;
+      }
+      continue;
+    }
+
+    break;
+  }
+
+  return called;
+}  // hs_dispatch
+
+// Runs the hardware for the given number of PIO cycles. Returns false as
+// soon as nothing moves anymore.
+bool hs_run(uint32_t cycles, bool* irq) {
+  for (uint32_t i = 0; i < cycles; i++) {
+    if (hs_dispatch())
+      *irq = true;
+
+    if (!hs_cycle()) {
+      if (hs_dispatch()) {
+        *irq = true;
+        continue;
+      }
+      return false;
+    }
+  }
+
+  return true;
+}  // hs_run
+
+// called by every register the library busy waits on
+void hs_poll() {
+  bool irq = false;
+
+  if (hs_run(HS_POLL_CYCLES, &irq) || irq) {
+    hs_idle_polls = 0;
+    return;
+  }
+
+  // an idle machine only changes on a TE edge
+  if (hs_te_callback && hostsim_lcd_te_enabled() && !hs_exception) {
+    hs_now_ps = hs_te_next_ps;
+    hs_te_update();
+    return;
+  }
+
+  if (++hs_idle_polls > HS_MAX_IDLE_POLLS)
+    hs_fatal("waiting for hardware which is idle (core1 is not simulated)");
+}  // hs_poll
+
+void hostsim_run_idle() {
+  bool irq = false;
+  while (hs_run(HS_POLL_CYCLES, &irq))
+    ;
+}  // hostsim_run_idle
+
+void __wfe() {
+  if (!hs_event) {
+    bool irq = false;
+    while (!irq && hs_run(HS_POLL_CYCLES, &irq))
+      ;
+    if (!irq && !hs_event)
+      hs_poll();
+  }
+
+  hs_event = false;
+}  // __wfe
+
+void __sev() {
+  hs_event = true;
+}  // __sev
+
+uint __get_current_exception() {
+  return hs_exception;
+}  // __get_current_exception
+
+uint32_t clock_get_hz(enum clock_index clk) {
+  return F_CPU;
+}  // clock_get_hz
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+  hs_gpio_func[gpio & 31] = fn;
+}  // gpio_set_function
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+  hs_irq_handler[num & 31] = handler;
+}  // irq_set_exclusive_handler
+
+void irq_set_enabled(uint num, bool enabled) {
+  hs_irq_enabled[num & 31] = enabled;
+}  // irq_set_enabled
+
+/* -------------------------- pwm, core1 --------------------------- */
+pwm_config pwm_get_default_config() {
+  pwm_config c = { 1.0f, 0xffff };
+  return c;
+}  // pwm_get_default_config
+
+void pwm_config_set_clkdiv(pwm_config* c, float div) {
+  c->div = div;
+}  // pwm_config_set_clkdiv
+
+void pwm_config_set_wrap(pwm_config* c, uint16_t wrap) {
+  c->wrap = wrap;
+}  // pwm_config_set_wrap
+
+void pwm_init(uint slice_num, pwm_config* c, bool start) {}
+
+uint pwm_gpio_to_slice_num(uint gpio) {
+  return (gpio >> 1) & 7;
+}  // pwm_gpio_to_slice_num
+
+void pwm_clear_irq(uint slice_num) {}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {}
+
+void multicore_launch_core1(void (*entry)(void)) {
+  static bool warned = false;
+
+  if (!warned)
+    fprintf(stderr, "hostsim: core1 is not simulated, frames it would render never complete\n");
+  warned = true;
+}  // multicore_launch_core1
+
+void multicore_reset_core1() {}
+
+/* ------------------------------ pio ------------------------------ */
+uint hs_tx_depth(hs_sm_t* sm) {
+  return sm->cfg.fifo_join == PIO_FIFO_JOIN_TX ? 8 : sm->cfg.fifo_join == PIO_FIFO_JOIN_RX ? 0 : 4;
+}  // hs_tx_depth
+
+uint hs_rx_depth(hs_sm_t* sm) {
+  return sm->cfg.fifo_join == PIO_FIFO_JOIN_RX ? 8 : sm->cfg.fifo_join == PIO_FIFO_JOIN_TX ? 0 : 4;
+}  // hs_rx_depth
+
+uint32_t hs_fifo_pop(uint32_t* fifo, uint8_t* level) {
+  uint32_t v = fifo[0];
+  for (int i = 1; i < *level; i++)
+    fifo[i - 1] = fifo[i];
+  (*level)--;
+  return v;
+}  // hs_fifo_pop
+
+// collects pin writes of one cycle, side-set last (it has priority)
+void hs_pins_set(int p, uint base, uint count, uint32_t value) {
+  for (uint i = 0; i < count; i++) {
+    uint pin = (base + i) & 31;
+    if (hs_gpio_func[pin] != GPIO_FUNC_PIO0 + p)
+      continue;
+    if ((value >> i) & 1)
+      hs_gpio_next |= 1u << pin;
+    else
+      hs_gpio_next &= ~(1u << pin);
+  }
+}  // hs_pins_set
+
+// the LCD latches DC and the data lines on the rising edge of WR
+bool hs_pins_commit() {
+  uint32_t before = hs_gpio_out;
+
+  hs_gpio_out = hs_gpio_next;
+  if (before == hs_gpio_out)
+    return false;
+
+  if (!((before >> PIN_LCD_WR) & 1) && ((hs_gpio_out >> PIN_LCD_WR) & 1))
+    hostsim_lcd_write((hs_gpio_out >> PIN_LCD_DC) & 1, (hs_gpio_out >> PIN_LCD_D0) & 0xff);
+
+  return true;
+}  // hs_pins_commit
+
+uint32_t hs_bit_reverse(uint32_t v) {
+  uint32_t r = 0;
+  for (int i = 0; i < 32; i++)
+    r |= ((v >> i) & 1) << (31 - i);
+  return r;
+}  // hs_bit_reverse
+
+// Executes one instruction. Returns false if it stalls without changing
+// anything, i.e. the state machine made no progress.
+bool hs_exec(int p, int n, uint16_t instr, bool exec) {
+  hs_pio_t* pio = &hs_pio[p];
+  hs_sm_t* sm = &pio->sm[n];
+  pio_sm_config* c = &sm->cfg;
+
+  uint op = instr >> 13;
+  uint arg1 = (instr >> 5) & 7;
+  uint arg2 = instr & 0x1f;
+  uint count = arg2 ? arg2 : 32;
+
+  uint field = (instr >> 8) & 0x1f;
+  uint delay_bits = 5 - c->sideset_bits;
+  uint side_count = c->sideset_bits - (c->sideset_opt ? 1 : 0);
+  bool side_en = side_count > 0 && (!c->sideset_opt || (field & 0x10));
+  uint side = (field >> delay_bits) & ((1u << side_count) - 1);
+  uint delay = field & ((1u << delay_bits) - 1);
+
+  uint pull_threshold = c->pull_threshold ? c->pull_threshold : 32;
+  uint push_threshold = c->push_threshold ? c->push_threshold : 32;
+
+  bool stall = false;
+  bool tx_stall = false;
+  bool jumped = false;
+  uint32_t v = 0;
+
+  hs_gpio_next = hs_gpio_out;
+
+  // stall conditions
+  switch (op) {
+    case 1:  // WAIT
+      {
+        bool pol = (instr >> 7) & 1;
+        uint src = (instr >> 5) & 3;
+        bool level;
+        if (src == 2)
+          level = (pio->irq >> (arg2 & 7)) & 1;
+        else
+          level = (hs_gpio_out >> ((src == 1 ? c->in_base + arg2 : arg2) & 31)) & 1;
+        stall = level != pol;
+      }
+      break;
+    case 2:  // IN
+      stall = c->autopush && sm->isr_count >= push_threshold && sm->rx_level >= hs_rx_depth(sm);
+      break;
+    case 3:  // OUT
+      tx_stall = stall = c->autopull && sm->osr_count >= pull_threshold && sm->tx_level == 0;
+      break;
+    case 4:
+      if (instr & 0x80) {  // PULL
+        bool if_empty = instr & 0x40, block = instr & 0x20;
+        tx_stall = stall = block && !(if_empty && sm->osr_count < pull_threshold) && sm->tx_level == 0;
+      } else {  // PUSH
+        bool if_full = instr & 0x40, block = instr & 0x20;
+        stall = block && !(if_full && sm->isr_count < push_threshold) && sm->rx_level >= hs_rx_depth(sm);
+      }
+      break;
+  }
+
+  if (stall) {
+    if (tx_stall)
+      pio->fdebug |= 1u << (PIO_FDEBUG_TXSTALL_LSB + n);
+    if (side_en)
+      hs_pins_set(p, c->sideset_base, side_count, side);
+    return hs_pins_commit();
+  }
+
+  if (exec)
+    sm->exec_pending = false;
+
+  switch (op) {
+    case 0:  // JMP
+      {
+        bool cond;
+        switch (arg1) {
+          case 0: cond = true; break;
+          case 1: cond = sm->x == 0; break;
+          case 2: cond = sm->x-- != 0; break;
+          case 3: cond = sm->y == 0; break;
+          case 4: cond = sm->y-- != 0; break;
+          case 5: cond = sm->x != sm->y; break;
+          case 6: cond = (hs_gpio_out >> ((c->in_base) & 31)) & 1; break;
+          default: cond = sm->osr_count < pull_threshold; break;
+        }
+        if (cond) {
+          sm->pc = arg2;
+          jumped = true;
+        }
+      }
+      break;
+    case 1:  // WAIT
+      if (((instr >> 5) & 3) == 2 && ((instr >> 7) & 1))
+        pio->irq &= ~(1u << (arg2 & 7));
+      break;
+    case 2:  // IN
+      switch (arg1) {
+        case 0: v = (hs_gpio_out >> c->in_base) | (hs_gpio_out << (32 - c->in_base)); break;
+        case 1: v = sm->x; break;
+        case 2: v = sm->y; break;
+        case 6: v = sm->isr; break;
+        case 7: v = sm->osr; break;
+        default: v = 0; break;
+      }
+      if (count < 32)
+        v &= (1u << count) - 1;
+      if (count == 32)
+        sm->isr = v;
+      else if (c->in_shift_right)
+        sm->isr = (sm->isr >> count) | (v << (32 - count));
+      else
+        sm->isr = (sm->isr << count) | v;
+      sm->isr_count = sm->isr_count + count > 32 ? 32 : sm->isr_count + count;
+      if (c->autopush && sm->isr_count >= push_threshold) {
+        sm->rx[sm->rx_level++] = sm->isr;
+        sm->isr = 0;
+        sm->isr_count = 0;
+      }
+      break;
+    case 3:  // OUT
+      if (c->autopull && sm->osr_count >= pull_threshold) {
+        sm->osr = hs_fifo_pop(sm->tx, &sm->tx_level);
+        sm->osr_count = 0;
+      }
+      if (count == 32) {
+        v = sm->osr;
+        sm->osr = 0;
+      } else if (c->out_shift_right) {
+        v = sm->osr & ((1u << count) - 1);
+        sm->osr >>= count;
+      } else {
+        v = sm->osr >> (32 - count);
+        sm->osr <<= count;
+      }
+      sm->osr_count = sm->osr_count + count > 32 ? 32 : sm->osr_count + count;
+      switch (arg1) {
+        case 0: hs_pins_set(p, c->out_base, c->out_count, v); break;
+        case 1: sm->x = v; break;
+        case 2: sm->y = v; break;
+        case 5: sm->pc = v & 31; jumped = true; break;
+        case 6: sm->isr = v; sm->isr_count = count; break;
+        case 7: sm->exec_pending = true; sm->exec_instr = v; break;
+      }
+      break;
+    case 4:
+      if (instr & 0x80) {  // PULL
+        bool if_empty = instr & 0x40;
+        if (!(if_empty && sm->osr_count < pull_threshold)) {
+          sm->osr = sm->tx_level ? hs_fifo_pop(sm->tx, &sm->tx_level) : sm->x;
+          sm->osr_count = 0;
+        }
+      } else {  // PUSH
+        bool if_full = instr & 0x40;
+        if (!(if_full && sm->isr_count < push_threshold)) {
+          if (sm->rx_level < hs_rx_depth(sm))
+            sm->rx[sm->rx_level++] = sm->isr;
+          sm->isr = 0;
+          sm->isr_count = 0;
+        }
+      }
+      break;
+    case 5:  // MOV
+      switch (instr & 7) {
+        case 0: v = (hs_gpio_out >> c->in_base) | (hs_gpio_out << (32 - c->in_base)); break;
+        case 1: v = sm->x; break;
+        case 2: v = sm->y; break;
+        case 6: v = sm->isr; break;
+        case 7: v = sm->osr; break;
+        default: v = 0; break;
+      }
+      if (((instr >> 3) & 3) == 1)
+        v = ~v;
+      else if (((instr >> 3) & 3) == 2)
+        v = hs_bit_reverse(v);
+      switch (arg1) {
+        case 0: hs_pins_set(p, c->out_base, c->out_count, v); break;
+        case 1: sm->x = v; break;
+        case 2: sm->y = v; break;
+        case 4: sm->exec_pending = true; sm->exec_instr = v; break;
+        case 5: sm->pc = v & 31; jumped = true; break;
+        case 6: sm->isr = v; sm->isr_count = 0; break;
+        case 7: sm->osr = v; sm->osr_count = 0; break;
+      }
+      break;
+    case 6:  // IRQ
+      if (instr & 0x40)
+        pio->irq &= ~(1u << (arg2 & 7));
+      else
+        pio->irq |= 1u << (arg2 & 7);
+      break;
+    case 7:  // SET
+      switch (arg1) {
+        case 0: hs_pins_set(p, c->set_base, c->set_count, arg2); break;
+        case 1: sm->x = arg2; break;
+        case 2: sm->y = arg2; break;
+      }
+      break;
+  }
+
+  if (side_en)
+    hs_pins_set(p, c->sideset_base, side_count, side);
+  hs_pins_commit();
+
+  // exec'd instructions do not advance the program counter
+  if (!jumped && !exec)
+    sm->pc = sm->pc == c->wrap ? c->wrap_target : (sm->pc + 1) & 31;
+
+  sm->delay = delay;
+
+  return true;
+}  // hs_exec
+
+bool hs_sm_cycle(int p, int n) {
+  hs_sm_t* sm = &hs_pio[p].sm[n];
+
+  if (!sm->enabled)
+    return false;
+
+  if (sm->delay) {
+    sm->delay--;
+    return true;
+  }
+
+  if (sm->exec_pending)
+    return hs_exec(p, n, sm->exec_instr, true);
+
+  return hs_exec(p, n, hs_pio[p].imem[sm->pc], false);
+}  // hs_sm_cycle
+
+pio_sm_config pio_get_default_sm_config() {
+  pio_sm_config c;
+  memset(&c, 0, sizeof(c));
+  c.wrap = 31;
+  c.out_count = 32;
+  c.out_shift_right = true;
+  c.in_shift_right = true;
+  c.clkdiv_int = 1;
+  return c;
+}  // pio_get_default_sm_config
+
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap) {
+  c->wrap_target = wrap_target;
+  c->wrap = wrap;
+}  // sm_config_set_wrap
+
+void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs) {
+  c->sideset_bits = bit_count;
+  c->sideset_opt = optional;
+}  // sm_config_set_sideset
+
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base) {
+  c->sideset_base = sideset_base;
+}  // sm_config_set_sideset_pins
+
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count) {
+  c->out_base = out_base;
+  c->out_count = out_count;
+}  // sm_config_set_out_pins
+
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count) {
+  c->set_base = set_base;
+  c->set_count = set_count;
+}  // sm_config_set_set_pins
+
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base) {
+  c->in_base = in_base;
+}  // sm_config_set_in_pins
+
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold) {
+  c->out_shift_right = shift_right;
+  c->autopull = autopull;
+  c->pull_threshold = pull_threshold & 0x1f;
+}  // sm_config_set_out_shift
+
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold) {
+  c->in_shift_right = shift_right;
+  c->autopush = autopush;
+  c->push_threshold = push_threshold & 0x1f;
+}  // sm_config_set_in_shift
+
+void sm_config_set_fifo_join(pio_sm_config* c, enum pio_fifo_join join) {
+  c->fifo_join = join;
+}  // sm_config_set_fifo_join
+
+void sm_config_set_clkdiv_int_frac(pio_sm_config* c, uint16_t div_int, uint8_t div_frac) {
+  c->clkdiv_int = div_int;
+  c->clkdiv_frac = div_frac;
+}  // sm_config_set_clkdiv_int_frac
+
+// all state machines are assumed to run at the clock set last
+void hs_set_clock(const pio_sm_config* c) {
+  double div = c->clkdiv_int ? c->clkdiv_int + c->clkdiv_frac / 256.0 : 65536.0;
+  hostsim_cycle_ps = 1e12 * div / F_CPU;
+}  // hs_set_clock
+
+uint pio_add_program(PIO pio, const pio_program_t* program) {
+  hs_pio_t* hp = &hs_pio[pio - hostsim_pio];
+  uint32_t mask = (1u << program->length) - 1;
+  int offset;
+
+  // like the SDK, programs are placed from the top of the memory down
+  for (offset = 32 - program->length; offset >= 0; offset--)
+    if (!(hp->used & (mask << offset)))
+      break;
+
+  if (offset < 0)
+    hs_fatal("no PIO program space");
+
+  for (int i = 0; i < program->length; i++) {
+    uint16_t instr = program->instructions[i];
+    hp->imem[offset + i] = (instr >> 13) == 0 ? instr + offset : instr;
+  }
+  hp->used |= mask << offset;
+
+  return offset;
+}  // pio_add_program
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+  hs_pio_t* hp = &hs_pio[pio - hostsim_pio];
+
+  for (int n = 0; n < NUM_PIO_STATE_MACHINES; n++)
+    if (!hp->sm[n].claimed) {
+      hp->sm[n].claimed = true;
+      return n;
+    }
+
+  if (required)
+    hs_fatal("no free PIO state machine");
+
+  return -1;
+}  // pio_claim_unused_sm
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+  hs_pio[pio - hostsim_pio].sm[sm].claimed = false;
+}  // pio_sm_unclaim
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config) {
+  hs_sm_t* s = &hs_pio[pio - hostsim_pio].sm[sm];
+
+  s->enabled = false;
+  s->cfg = config ? *config : pio_get_default_sm_config();
+  s->pc = initial_pc;
+  s->delay = 0;
+  s->osr = s->isr = 0;
+  s->osr_count = 32;
+  s->isr_count = 0;
+  s->tx_level = s->rx_level = 0;
+  s->exec_pending = false;
+
+  hs_set_clock(&s->cfg);
+}  // pio_sm_init
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+  hs_pio[pio - hostsim_pio].sm[sm].enabled = enabled;
+}  // pio_sm_set_enabled
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac) {
+  pio_sm_config* c = &hs_pio[pio - hostsim_pio].sm[sm].cfg;
+  sm_config_set_clkdiv_int_frac(c, div_int, div_frac);
+  hs_set_clock(c);
+}  // pio_sm_set_clkdiv_int_frac
+
+void pio_gpio_init(PIO pio, uint pin) {
+  gpio_set_function(pin, (enum gpio_function)(GPIO_FUNC_PIO0 + (pio - hostsim_pio)));
+}  // pio_gpio_init
+
+int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {
+  return 0;
+}  // pio_sm_set_consecutive_pindirs
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+  hs_sm_t* s = &hs_pio[pio - hostsim_pio].sm[sm];
+
+  if (s->tx_level < hs_tx_depth(s))
+    s->tx[s->tx_level++] = data;
+}  // pio_sm_put
+
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+  hostsim_pio_instr r;
+  r.pio = pio - hostsim_pio;
+  r.sm = sm;
+  r = instr;
+}  // pio_sm_exec
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+  hs_poll();
+  return hs_pio[pio - hostsim_pio].sm[sm].rx_level == 0;
+}  // pio_sm_is_rx_fifo_empty
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+  return (pio - hostsim_pio) * 8 + (is_tx ? 0 : 4) + sm;
+}  // pio_get_dreq
+
+void hostsim_pio_txf::operator=(uint32_t value) {
+  hs_sm_t* s = &hs_pio[pio].sm[sm];
+
+  while (s->tx_level >= hs_tx_depth(s))
+    hs_poll();
+
+  s->tx[s->tx_level++] = value;
+}  // hostsim_pio_txf::operator=
+
+hostsim_pio_rxf::operator uint32_t() {
+  hs_sm_t* s = &hs_pio[pio].sm[sm];
+  return s->rx_level ? hs_fifo_pop(s->rx, &s->rx_level) : 0;
+}  // hostsim_pio_rxf::operator uint32_t
+
+// an instruction written to SMx_INSTR runs at once, a stalling one is
+// latched until it can complete
+void hostsim_pio_instr::operator=(uint32_t instr) {
+  hs_sm_t* s = &hs_pio[pio].sm[sm];
+
+  s->exec_pending = true;
+  s->exec_instr = instr;
+  hs_exec(pio, sm, instr, true);
+}  // hostsim_pio_instr::operator=
+
+hostsim_pio_fdebug::operator uint32_t() {
+  hs_poll();
+  return hs_pio[pio].fdebug;
+}  // hostsim_pio_fdebug::operator uint32_t
+
+void hostsim_pio_fdebug::operator=(uint32_t clear) {
+  hs_pio[pio].fdebug &= ~clear;
+}  // hostsim_pio_fdebug::operator=
+
+/* ------------------------------ dma ------------------------------ */
+bool hs_pio_fifo(uintptr_t addr, bool tx, int* p, int* n) {
+  for (*p = 0; *p < 2; (*p)++)
+    for (*n = 0; *n < NUM_PIO_STATE_MACHINES; (*n)++)
+      if (addr == (tx ? (uintptr_t) &hostsim_pio[*p].txf[*n] : (uintptr_t) &hostsim_pio[*p].rxf[*n]))
+        return true;
+
+  return false;
+}  // hs_pio_fifo
+
+bool hs_dma_reg(uintptr_t addr, int* ch, size_t* ofs) {
+  uintptr_t base = (uintptr_t) &hostsim_dma;
+
+  if (addr < base || addr >= base + sizeof(hostsim_dma))
+    return false;
+
+  *ch = (addr - base) / sizeof(dma_channel_hw_t);
+  *ofs = (addr - base) % sizeof(dma_channel_hw_t);
+
+  return true;
+}  // hs_dma_reg
+
+bool hs_dreq(uint dreq) {
+  if (dreq == DREQ_FORCE)
+    return true;
+
+  hs_sm_t* s = &hs_pio[dreq / 8].sm[dreq % 4];
+
+  if ((dreq % 8) < 4)
+    return s->tx_level < hs_tx_depth(s);
+
+  return s->rx_level > 0;
+}  // hs_dreq
+
+void hs_dma_mirror(int ch) {
+  hs_dma_t* c = &hs_dma[ch];
+  dma_channel_hw_t* hw = &hostsim_dma.ch[ch];
+
+  hw->read_addr = c->read;
+  hw->write_addr = c->write;
+  hw->transfer_count = c->count;
+  hw->al1_ctrl = (c->cfg.irq_quiet ? DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS : 0) | (c->busy ? 0x01000000u : 0);
+}  // hs_dma_mirror
+
+void hs_dma_trigger(int ch, bool null_trigger);
+
+void hs_dma_complete(int ch) {
+  hs_dma_t* c = &hs_dma[ch];
+
+  c->busy = false;
+  if (!c->cfg.irq_quiet)
+    hs_dma_ints |= 1u << ch;
+
+  hs_dma_mirror(ch);
+
+  if (c->cfg.chain_to != ch)
+    hs_dma_trigger(c->cfg.chain_to, false);
+}  // hs_dma_complete
+
+// a trigger with a null read address does not start the channel but raises
+// its interrupt if it is quiet (this ends the row chains)
+void hs_dma_trigger(int ch, bool null_trigger) {
+  hs_dma_t* c = &hs_dma[ch];
+
+  if (null_trigger) {
+    if (c->cfg.irq_quiet)
+      hs_dma_ints |= 1u << ch;
+    return;
+  }
+
+  c->count = c->reload;
+  c->busy = true;
+  hs_dma_mirror(ch);
+
+  if (!c->count)
+    hs_dma_complete(ch);
+}  // hs_dma_trigger
+
+void hs_dma_reg_write(int ch, size_t ofs, uintptr_t v) {
+  hs_dma_t* c = &hs_dma[ch];
+
+  switch (ofs / sizeof(uintptr_t)) {
+    case offsetof(dma_channel_hw_t, read_addr) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al1_read_addr) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al2_read_addr) / sizeof(uintptr_t):
+      c->read = v;
+      break;
+    case offsetof(dma_channel_hw_t, al3_read_addr_trig) / sizeof(uintptr_t):
+      c->read = v;
+      hs_dma_trigger(ch, v == 0);
+      break;
+    case offsetof(dma_channel_hw_t, write_addr) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al1_write_addr) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al3_write_addr) / sizeof(uintptr_t):
+      c->write = v;
+      break;
+    case offsetof(dma_channel_hw_t, al2_write_addr_trig) / sizeof(uintptr_t):
+      c->write = v;
+      hs_dma_trigger(ch, v == 0);
+      break;
+    case offsetof(dma_channel_hw_t, transfer_count) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al2_transfer_count) / sizeof(uintptr_t):
+    case offsetof(dma_channel_hw_t, al3_transfer_count) / sizeof(uintptr_t):
+      c->reload = v;
+      break;
+    case offsetof(dma_channel_hw_t, al1_transfer_count_trig) / sizeof(uintptr_t):
+      c->reload = v;
+      hs_dma_trigger(ch, v == 0);
+      break;
+    default:
+      hs_fatal("DMA control register writes are not simulated");
+  }
+
+  hs_dma_mirror(ch);
+}  // hs_dma_reg_write
+
+// CRC-32 as computed by the sniffer (mode 0), bytes in address order
+void hs_sniff(uint64_t v, uint size) {
+  for (uint b = 0; b < size; b++) {
+    hs_sniff_acc ^= (uint32_t)((v >> (8 * b)) & 0xff) << 24;
+    for (int i = 0; i < 8; i++)
+      hs_sniff_acc = (hs_sniff_acc & 0x80000000u) ? (hs_sniff_acc << 1) ^ 0x04c11db7u : hs_sniff_acc << 1;
+  }
+}  // hs_sniff
+
+void hs_dma_transfer(int ch) {
+  hs_dma_t* c = &hs_dma[ch];
+  uint size = 1u << c->cfg.size;
+  uint step = size;
+  uint64_t v = 0;
+  int p, n, dch;
+  size_t dofs;
+
+  bool to_reg = hs_dma_reg(c->write, &dch, &dofs);
+
+  // words copied from memory into DMA registers are host pointers
+  if (hs_pio_fifo(c->read, false, &p, &n)) {
+    hs_sm_t* s = &hs_pio[p].sm[n];
+    v = s->rx_level ? hs_fifo_pop(s->rx, &s->rx_level) : 0;
+  } else if (to_reg && size == 4) {
+    v = *(const uintptr_t*) c->read;
+    step = sizeof(uintptr_t);
+  } else {
+    memcpy(&v, (const void*) c->read, size);
+  }
+
+  if (c->cfg.bswap && size == 2)
+    v = ((v & 0xff) << 8) | ((v >> 8) & 0xff);
+  else if (c->cfg.bswap && size == 4)
+    v = __builtin_bswap32((uint32_t) v);
+
+  if (c->cfg.sniff && hs_sniff_chan == ch)
+    hs_sniff(v, size);
+
+  if (hs_pio_fifo(c->write, true, &p, &n)) {
+    // narrow writes to the FIFO are replicated across the bus
+    uint32_t w = size == 1 ? (uint32_t) v * 0x01010101u : size == 2 ? (uint32_t) v * 0x00010001u : (uint32_t) v;
+    hs_sm_t* s = &hs_pio[p].sm[n];
+    if (s->tx_level < hs_tx_depth(s))
+      s->tx[s->tx_level++] = w;
+  } else if (to_reg) {
+    hs_dma_reg_write(dch, dofs, (uintptr_t) v);
+  } else {
+    memcpy((void*) c->write, &v, size);
+  }
+
+  if (c->cfg.read_increment)
+    c->read += step;
+  if (c->cfg.write_increment)
+    c->write += size;
+
+  c->count--;
+  hs_dma_mirror(ch);
+
+  if (!c->count)
+    hs_dma_complete(ch);
+}  // hs_dma_transfer
+
+// the DMA moves everything its DREQs allow within one cycle
+bool hs_dma_run() {
+  bool progress = false;
+  bool again = true;
+
+  while (again) {
+    again = false;
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+      hs_dma_t* c = &hs_dma[ch];
+      while (c->busy && c->cfg.enable && hs_dreq(c->cfg.dreq)) {
+        hs_dma_transfer(ch);
+        progress = again = true;
+      }
+    }
+  }
+
+  return progress;
+}  // hs_dma_run
+
+bool hs_cycle() {
+  bool progress = hs_dma_run();
+
+  for (int p = 0; p < 2; p++)
+    for (int n = 0; n < NUM_PIO_STATE_MACHINES; n++)
+      progress |= hs_sm_cycle(p, n);
+
+  progress |= hs_dma_run();
+
+  // time only passes while something is moving, idle time is skipped
+  if (progress) {
+    hostsim_bus_cycles++;
+    hs_now_ps += hostsim_cycle_ps;
+    hs_te_update();
+  }
+
+  return progress;
+}  // hs_cycle
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+  dma_channel_config c;
+  c.size = DMA_SIZE_32;
+  c.read_increment = true;
+  c.write_increment = false;
+  c.dreq = DREQ_FORCE;
+  c.chain_to = channel;
+  c.irq_quiet = false;
+  c.bswap = false;
+  c.sniff = false;
+  c.enable = true;
+  return c;
+}  // dma_channel_get_default_config
+
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+  c->size = size;
+}  // channel_config_set_transfer_data_size
+
+void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+  c->read_increment = incr;
+}  // channel_config_set_read_increment
+
+void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+  c->write_increment = incr;
+}  // channel_config_set_write_increment
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+  c->dreq = dreq;
+}  // channel_config_set_dreq
+
+void channel_config_set_chain_to(dma_channel_config* c, uint chain_to) {
+  c->chain_to = chain_to;
+}  // channel_config_set_chain_to
+
+void channel_config_set_irq_quiet(dma_channel_config* c, bool irq_quiet) {
+  c->irq_quiet = irq_quiet;
+}  // channel_config_set_irq_quiet
+
+void channel_config_set_bswap(dma_channel_config* c, bool bswap) {
+  c->bswap = bswap;
+}  // channel_config_set_bswap
+
+void channel_config_set_sniff_enable(dma_channel_config* c, bool sniff_enable) {
+  c->sniff = sniff_enable;
+}  // channel_config_set_sniff_enable
+
+void channel_config_set_enable(dma_channel_config* c, bool enable) {
+  c->enable = enable;
+}  // channel_config_set_enable
+
+int dma_claim_unused_channel(bool required) {
+  for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++)
+    if (!hs_dma[ch].claimed) {
+      hs_dma[ch].claimed = true;
+      return ch;
+    }
+
+  if (required)
+    hs_fatal("no free DMA channel");
+
+  return -1;
+}  // dma_claim_unused_channel
+
+void dma_channel_unclaim(uint channel) {
+  hs_dma[channel].claimed = false;
+}  // dma_channel_unclaim
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger) {
+  hs_dma_t* c = &hs_dma[channel];
+
+  c->cfg = *config;
+  c->write = (uintptr_t) write_addr;
+  c->read = (uintptr_t) read_addr;
+  c->reload = transfer_count;
+  hs_dma_mirror(channel);
+
+  if (trigger)
+    hs_dma_trigger(channel, false);
+}  // dma_channel_configure
+
+void dma_channel_abort(uint channel) {
+  hs_dma[channel].busy = false;
+  hs_dma_mirror(channel);
+}  // dma_channel_abort
+
+bool dma_channel_is_busy(uint channel) {
+  if (hs_dma[channel].busy)
+    hs_poll();
+
+  return hs_dma[channel].busy;
+}  // dma_channel_is_busy
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+  while (dma_channel_is_busy(channel))
+    ;
+}  // dma_channel_wait_for_finish_blocking
+
+dma_channel_hw_t* dma_channel_hw_addr(uint channel) {
+  return &hostsim_dma.ch[channel];
+}  // dma_channel_hw_addr
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+  if (enabled)
+    hs_dma_inte0 |= 1u << channel;
+  else
+    hs_dma_inte0 &= ~(1u << channel);
+}  // dma_channel_set_irq0_enabled
+
+bool dma_channel_get_irq0_status(uint channel) {
+  return (hs_dma_ints >> channel) & 1;
+}  // dma_channel_get_irq0_status
+
+void dma_channel_acknowledge_irq0(uint channel) {
+  hs_dma_ints &= ~(1u << channel);
+}  // dma_channel_acknowledge_irq0
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+  if (mode != 0)
+    hs_fatal("only the CRC-32 sniffer mode is simulated");
+
+  hs_sniff_chan = channel;
+  if (force_channel_enable)
+    hs_dma[channel].cfg.sniff = true;
+}  // dma_sniffer_enable
+
+void dma_sniffer_disable() {
+  hs_sniff_chan = -1;
+}  // dma_sniffer_disable
+
+void dma_sniffer_set_data_accumulator(uint32_t seed) {
+  hs_sniff_acc = seed;
+}  // dma_sniffer_set_data_accumulator
+
+uint32_t dma_sniffer_get_data_accumulator() {
+  return hs_sniff_acc;
+}  // dma_sniffer_get_data_accumulator
+
+/* -------------------------- interpolator ------------------------- */
+interp_config interp_default_config() {
+  interp_config c = { 0, 0, 31, false, false };
+  return c;
+}  // interp_default_config
+
+void interp_config_set_shift(interp_config* c, uint shift) {
+  c->shift = shift;
+}  // interp_config_set_shift
+
+void interp_config_set_mask(interp_config* c, uint mask_lsb, uint mask_msb) {
+  c->mask_lsb = mask_lsb;
+  c->mask_msb = mask_msb;
+}  // interp_config_set_mask
+
+void interp_config_set_signed(interp_config* c, bool is_signed) {
+  c->is_signed = is_signed;
+}  // interp_config_set_signed
+
+void interp_config_set_add_raw(interp_config* c, bool add_raw) {
+  c->add_raw = add_raw;
+}  // interp_config_set_add_raw
+
+void interp_set_config(interp_hw_t* interp, uint lane, interp_config* config) {
+  interp->ctrl[lane] = *config;
+}  // interp_set_config
+
+uint32_t hs_interp_lane(interp_hw_t* in, int lane) {
+  interp_config* c = &in->ctrl[lane];
+  uint32_t hi = c->mask_msb >= 31 ? 0xffffffffu : (1u << (c->mask_msb + 1)) - 1;
+  uint32_t mask = hi & ~((1u << c->mask_lsb) - 1);
+  uint32_t v = (in->accum[lane] >> c->shift) & mask;
+
+  if (c->is_signed && ((v >> c->mask_msb) & 1))
+    v |= ~hi;
+
+  return v;
+}  // hs_interp_lane
+
+void hs_interp_results(interp_hw_t* in, uint32_t* result) {
+  uint32_t lane0 = hs_interp_lane(in, 0);
+  uint32_t lane1 = hs_interp_lane(in, 1);
+
+  result[0] = in->base[0] + (in->ctrl[0].add_raw ? in->accum[0] : lane0);
+  result[1] = in->base[1] + (in->ctrl[1].add_raw ? in->accum[1] : lane1);
+  result[2] = in->base[2] + lane0 + lane1;
+}  // hs_interp_results
+
+hostsim_interp_pop::operator uint32_t() {
+  interp_hw_t* in = &hostsim_interp[interp];
+  uint32_t result[3];
+
+  hs_interp_results(in, result);
+  in->accum[0] = result[0];
+  in->accum[1] = result[1];
+
+  return result[lane];
+}  // hostsim_interp_pop::operator uint32_t
+
+hostsim_interp_peek::operator uint32_t() {
+  uint32_t result[3];
+
+  hs_interp_results(&hostsim_interp[interp], result);
+
+  return result[lane];
+}  // hostsim_interp_peek::operator uint32_t
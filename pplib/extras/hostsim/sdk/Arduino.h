@@ -0,0 +1,3 @@
+// (host simulator) see hostsim_sdk.h
+#include "hostsim_sdk.h"
+#include "avr/pgmspace.h"
@@ -0,0 +1,355 @@
+/*
+ * pplib - a library for the Pico Held handheld
+ *
+ * Copyright (C) 2023 Daniel Kammer (daniel.kammer@web.de)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// The part of the Arduino core and of the Pico SDK used by the LCD
+// interface and the graphics functions of pplib, implemented by the host
+// simulator (hostsim_sdk.cpp). The PIO and DMA registers accessed directly
+// by the library are modelled by small register objects.
+
+#ifndef HOSTSIM_SDK_H
+#define HOSTSIM_SDK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+typedef unsigned int uint;
+
+/* ============================ Arduino ============================ */
+typedef uint8_t byte;
+
+#define LOW             0
+#define HIGH            1
+
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+#define INPUT_PULLDOWN  3
+
+#define CHANGE          2
+#define FALLING         3
+#define RISING          4
+
+#define digitalPinToInterrupt(p) (p)
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int  digitalRead(uint8_t pin);
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+
+void attachInterrupt(uint8_t pin, void (*callback)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+/* ========================= core and sync ========================= */
+#define __not_in_flash_func(f) f
+#define __scratch_x(name)
+#define __isr
+
+void __wfe();
+void __sev();
+uint __get_current_exception();
+
+static inline void tight_loop_contents() {}
+
+// interrupts are only taken while the simulator runs the hardware
+static inline uint32_t save_and_disable_interrupts() { return 0; }
+static inline void restore_interrupts(uint32_t status) {}
+
+/* ============================= clocks ============================ */
+enum clock_index { clk_gpout0 = 0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys, clk_peri, clk_usb, clk_adc, clk_rtc };
+
+uint32_t clock_get_hz(enum clock_index clk);
+
+/* ============================== gpio ============================= */
+enum gpio_function { GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7, GPIO_FUNC_NULL = 0x1f };
+
+void gpio_set_function(uint gpio, enum gpio_function fn);
+
+/* =============================== irq ============================= */
+#define DMA_IRQ_0       11
+#define DMA_IRQ_1       12
+#define IO_IRQ_BANK0    13
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+/* =============================== pwm ============================= */
+typedef struct {
+  float div;
+  uint16_t wrap;
+} pwm_config;
+
+pwm_config pwm_get_default_config();
+void pwm_config_set_clkdiv(pwm_config* c, float div);
+void pwm_config_set_wrap(pwm_config* c, uint16_t wrap);
+void pwm_init(uint slice_num, pwm_config* c, bool start);
+uint pwm_gpio_to_slice_num(uint gpio);
+void pwm_clear_irq(uint slice_num);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+
+/* ============================ multicore ========================== */
+void multicore_launch_core1(void (*entry)(void));
+void multicore_reset_core1();
+
+/* =============================== pio ============================= */
+#define NUM_PIO_STATE_MACHINES  4
+#define PIO_FDEBUG_TXSTALL_LSB  24
+
+struct pio_program {
+  const uint16_t* instructions;
+  uint8_t length;
+  int8_t origin;
+};
+typedef struct pio_program pio_program_t;
+
+typedef struct {
+  uint8_t wrap_target;
+  uint8_t wrap;
+  uint8_t sideset_bits;      // including the enable bit
+  bool sideset_opt;
+  uint8_t sideset_base;
+  uint8_t out_base;
+  uint8_t out_count;
+  uint8_t set_base;
+  uint8_t set_count;
+  uint8_t in_base;
+  bool out_shift_right;
+  bool autopull;
+  uint8_t pull_threshold;
+  bool in_shift_right;
+  bool autopush;
+  uint8_t push_threshold;
+  uint8_t fifo_join;
+  uint16_t clkdiv_int;
+  uint8_t clkdiv_frac;
+} pio_sm_config;
+
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+
+// (the lower 3 bits are the operand of the instruction)
+enum pio_src_dest {
+  pio_pins = 0u, pio_x = 1u, pio_y = 2u, pio_null = 3u, pio_pindirs = 4u, pio_exec_mov = 0x14u,
+  pio_status = 5u, pio_pc = 0x15u, pio_isr = 6u, pio_osr = 7u, pio_exec_out = 0x17u
+};
+
+// registers written or read by the library directly
+struct hostsim_pio_reg {
+  uint8_t pio;
+  uint8_t sm;
+};
+
+struct hostsim_pio_txf : hostsim_pio_reg {
+  void operator=(uint32_t value);             // pushes into the TX FIFO
+};
+
+struct hostsim_pio_rxf : hostsim_pio_reg {
+  operator uint32_t();                        // pops from the RX FIFO
+};
+
+struct hostsim_pio_instr : hostsim_pio_reg {
+  void operator=(uint32_t instr);             // executes the instruction
+};
+
+struct hostsim_pio_fdebug : hostsim_pio_reg {
+  operator uint32_t();
+  void operator=(uint32_t clear);             // write 1 to clear
+};
+
+struct hostsim_pio_sm_hw {
+  hostsim_pio_instr instr;
+};
+
+typedef struct {
+  hostsim_pio_fdebug fdebug;
+  hostsim_pio_txf txf[NUM_PIO_STATE_MACHINES];
+  hostsim_pio_rxf rxf[NUM_PIO_STATE_MACHINES];
+  hostsim_pio_sm_hw sm[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+extern pio_hw_t hostsim_pio[2];
+
+#define pio0 (&hostsim_pio[0])
+#define pio1 (&hostsim_pio[1])
+
+pio_sm_config pio_get_default_sm_config();
+void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap);
+void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs);
+void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base);
+void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count);
+void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count);
+void sm_config_set_in_pins(pio_sm_config* c, uint in_base);
+void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_fifo_join(pio_sm_config* c, enum pio_fifo_join join);
+void sm_config_set_clkdiv_int_frac(pio_sm_config* c, uint16_t div_int, uint8_t div_frac);
+
+uint pio_add_program(PIO pio, const pio_program_t* program);
+int  pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac);
+void pio_gpio_init(PIO pio, uint pin);
+int  pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+static inline uint pio_encode_jmp(uint addr) { return 0x0000u | addr; }
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) { return 0x6000u | (dest & 7u) << 5 | (count & 0x1fu); }
+static inline uint pio_encode_pull(bool if_empty, bool block) { return 0x8080u | (if_empty ? 0x40u : 0) | (block ? 0x20u : 0); }
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) { return 0xa000u | (dest & 7u) << 5 | (src & 7u); }
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) { return 0xe000u | (dest & 7u) << 5 | (value & 0x1fu); }
+static inline uint pio_encode_nop() { return pio_encode_mov(pio_y, pio_y); }
+
+/* =============================== dma ============================= */
+#define NUM_DMA_CHANNELS  12
+#define DREQ_FORCE        0x3f
+
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS 0x00200000u
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+  uint8_t size;
+  bool read_increment;
+  bool write_increment;
+  uint8_t dreq;
+  uint8_t chain_to;
+  bool irq_quiet;
+  bool bswap;
+  bool sniff;
+  bool enable;
+} dma_channel_config;
+
+// Addresses are host pointers. The registers are plain memory, which the
+// simulator keeps up to date (writes by the DMA itself are recognised).
+typedef struct {
+  volatile uintptr_t read_addr;
+  volatile uintptr_t write_addr;
+  volatile uintptr_t transfer_count;
+  volatile uintptr_t ctrl_trig;
+  volatile uintptr_t al1_ctrl;
+  volatile uintptr_t al1_read_addr;
+  volatile uintptr_t al1_write_addr;
+  volatile uintptr_t al1_transfer_count_trig;
+  volatile uintptr_t al2_ctrl;
+  volatile uintptr_t al2_transfer_count;
+  volatile uintptr_t al2_read_addr;
+  volatile uintptr_t al2_write_addr_trig;
+  volatile uintptr_t al3_ctrl;
+  volatile uintptr_t al3_write_addr;
+  volatile uintptr_t al3_transfer_count;
+  volatile uintptr_t al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+  dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+} dma_hw_t;
+
+extern dma_hw_t hostsim_dma;
+
+#define dma_hw (&hostsim_dma)
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config* c, bool incr);
+void channel_config_set_write_increment(dma_channel_config* c, bool incr);
+void channel_config_set_dreq(dma_channel_config* c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config* c, uint chain_to);
+void channel_config_set_irq_quiet(dma_channel_config* c, bool irq_quiet);
+void channel_config_set_bswap(dma_channel_config* c, bool bswap);
+void channel_config_set_sniff_enable(dma_channel_config* c, bool sniff_enable);
+void channel_config_set_enable(dma_channel_config* c, bool enable);
+
+int  dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+dma_channel_hw_t* dma_channel_hw_addr(uint channel);
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq0_status(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable();
+void dma_sniffer_set_data_accumulator(uint32_t seed);
+uint32_t dma_sniffer_get_data_accumulator();
+
+/* ========================== interpolator ========================= */
+typedef struct {
+  uint8_t shift;
+  uint8_t mask_lsb;
+  uint8_t mask_msb;
+  bool is_signed;
+  bool add_raw;
+} interp_config;
+
+struct hostsim_interp_reg {
+  uint8_t interp;
+  uint8_t lane;
+};
+
+struct hostsim_interp_pop : hostsim_interp_reg {
+  operator uint32_t();
+};
+
+struct hostsim_interp_peek : hostsim_interp_reg {
+  operator uint32_t();
+};
+
+typedef struct {
+  uint32_t accum[2];
+  uint32_t base[3];
+  hostsim_interp_pop pop[3];
+  hostsim_interp_peek peek[3];
+  interp_config ctrl[2];
+} interp_hw_t;
+
+extern interp_hw_t hostsim_interp[2];
+
+#define interp0 (&hostsim_interp[0])
+#define interp1 (&hostsim_interp[1])
+
+interp_config interp_default_config();
+void interp_config_set_shift(interp_config* c, uint shift);
+void interp_config_set_mask(interp_config* c, uint mask_lsb, uint mask_msb);
+void interp_config_set_signed(interp_config* c, bool is_signed);
+void interp_config_set_add_raw(interp_config* c, bool add_raw);
+void interp_set_config(interp_hw_t* interp, uint lane, interp_config* config);
+
+#endif  // HOSTSIM_SDK_H
@@ -0,0 +1,2 @@
+// (host simulator) see hostsim_sdk.h
+#include "../hostsim_sdk.h"
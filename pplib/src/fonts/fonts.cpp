@@ -22,6 +22,7 @@
 
 #include "fonts.h"
 #include "../graphics/gbuffers.h"
+#include "../hardware/lcd_if/lcdcom.h"
 
 #include <Arduino.h>
 #include <stdint.h>
@@ -71,6 +72,7 @@ void font_put_char(coord_t pos_x, coord_t pos_y, color_t col, char c, font_t* fo
   uint8_t charHeight = font[FONT_HEADER_FNT_HEIGHT];
   uint16_t bufWidth = gbuf_get_width(dst);
   uint16_t bufHeight = gbuf_get_height(dst);
+  uint16_t bufStride = gbuf_get_stride(dst);
     
   uint32_t total_width = 0;
   
@@ -98,7 +100,7 @@ void font_put_char(coord_t pos_x, coord_t pos_y, color_t col, char c, font_t* fo
       if ((pos_y + y) >= 0 && (pos_y + y) < bufHeight &&
           (pos_x + x) >= 0 && (pos_x + x) < bufWidth) {
         if (fnt_dat & (1 << bitcnt))
-          dst.data[(pos_y + y) * bufWidth + (pos_x + x)] = col;
+          dst.data[(pos_y + y) * bufStride + (pos_x + x)] = col;
       }
       
       bitcnt++;
@@ -131,4 +133,120 @@ int font_get_string_width(char* str, font_t* font) {
 
 void font_write_string_centered(coord_t pos_x, coord_t y, color_t col, char* str, font_t* font, gbuffer_t dst) {
   font_write_string(pos_x - font_get_string_width(str, font) / 2, y, col, str, font, dst);
-}
\ No newline at end of file
+}
+
+/* --------------------------- direct output -------------------------- */
+void font_write_string_lcd(coord_t pos_x, coord_t pos_y, uint16_t col, uint16_t bg, char* str, font_t* font) {
+  uint8_t charHeight = font[FONT_HEADER_FNT_HEIGHT];
+  uint16_t cell[FONT_LCD_CELL_PIXELS];
+
+  for (int h = 0; str[h] != 0; pos_x += font_get_char_width(str[h], font) + 1, h++) {
+    char c = str[h];
+    uint8_t charWidth = font_get_char_width(c, font);
+
+    // character not defined
+    if (charWidth == 0)
+      continue;
+
+    uint32_t total_width = 0;
+
+    for (char i = font[FONT_HEADER_FRST_CHAR]; i < c; i++)
+      total_width += font_get_char_width(i, font);
+
+    // first bit of the glyph (stored column by column)
+    uint32_t glyph = font_get_data_ofs(font) * 8 + total_width * charHeight;
+
+    // the cell includes the column to the next character
+    uint16_t cellWidth = charWidth + 1;
+
+    // not even a single line fits into the cell
+    if (cellWidth > FONT_LCD_CELL_PIXELS)
+      continue;
+
+    uint16_t sliceHeight = FONT_LCD_CELL_PIXELS / cellWidth;
+
+    if (sliceHeight > charHeight)
+      sliceHeight = charHeight;
+
+    for (uint16_t y0 = 0; y0 < charHeight; y0 += sliceHeight) {
+      uint16_t rows = (charHeight - y0 < sliceHeight) ? charHeight - y0 : sliceHeight;
+
+      // the previous slice may still be on its way
+      lcd_wait_ready();
+
+      for (uint16_t y = 0; y < rows; y++) {
+        for (uint16_t x = 0; x < charWidth; x++) {
+          uint32_t bit = glyph + x * charHeight + y0 + y;
+          cell[y * cellWidth + x] = (font[bit / 8] & (1 << (bit % 8))) ? col : bg;
+        }
+        cell[y * cellWidth + charWidth] = bg;
+      }
+
+      gbuffer16_t slice = { 16, cellWidth, rows, cell, 0 };
+      lcd_draw_buf(pos_x, pos_y + y0, slice);
+    }
+  }
+
+  // the cell is on the stack
+  lcd_wait_ready();
+}
+
+/* -------------------------- packed buffers -------------------------- */
+void font_put_char(coord_t pos_x, coord_t pos_y, color8_t col, char c, font_t* font, gbuffer_packed_t dst) {
+  uint8_t charWidth = font_get_char_width(c, font);
+
+  // character not defined
+  if (charWidth == 0)
+    return;
+
+  uint8_t charHeight = font[FONT_HEADER_FNT_HEIGHT];
+  uint16_t bufWidth = gbuf_get_width(dst);
+  uint16_t bufHeight = gbuf_get_height(dst);
+
+  uint32_t total_width = 0;
+
+  for (char i = font[FONT_HEADER_FRST_CHAR]; i < c; i++)
+      total_width += font_get_char_width(i, font);
+
+  uint32_t total_bits = (total_width * charHeight);
+
+  uint16_t data_ofs = font_get_data_ofs(font) + total_bits / 8;
+
+  uint8_t bitcnt = (uint32_t) total_bits % 8;
+  uint8_t datcnt = 0;
+
+  char fnt_dat = font[data_ofs];
+
+  // the glyphs are stored column by column
+  for (uint16_t x = 0; x < charWidth; x++)
+    for (uint16_t y = 0; y < charHeight; y++) {
+      if (bitcnt == 8) {
+        bitcnt = 0;
+        datcnt++;
+        fnt_dat = font[data_ofs + datcnt];
+      }
+
+      if ((pos_y + y) >= 0 && (pos_y + y) < bufHeight &&
+          (pos_x + x) >= 0 && (pos_x + x) < bufWidth) {
+        if (fnt_dat & (1 << bitcnt))
+          gbuf_put_packed(dst, pos_x + x, pos_y + y, col);
+      }
+
+      bitcnt++;
+    }
+}
+
+void font_write_string(coord_t pos_x, coord_t pos_y, color8_t col, char* str, font_t* font, gbuffer_packed_t dst) {
+  int h = 0;
+  int ofs_x = 0;
+
+  while (str[h] != 0) {
+    font_put_char(pos_x + ofs_x, pos_y, col, str[h], font, dst);
+    ofs_x += font_get_char_width(str[h], font) + 1;
+    h++;
+  }
+}
+
+void font_write_string_centered(coord_t pos_x, coord_t y, color8_t col, char* str, font_t* font, gbuffer_packed_t dst) {
+  font_write_string(pos_x - font_get_string_width(str, font) / 2, y, col, str, font, dst);
+}
@@ -24,6 +24,11 @@
 /* ========================== includes ========================== */
 #include "../typedefs.h"
 
+/* ======================== definitions ========================= */
+// max. number of pixels of a character slice sent by font_write_string_lcd
+// (taken from the stack)
+#define FONT_LCD_CELL_PIXELS 512
+
 /* ==================== function declarations =================== */
 /* ------------------------------ measurement ------------------------------ */
 /**
@@ -105,5 +110,28 @@ void font_write_string(coord_t pos_x, coord_t pos_y, color_t col, char* str, fon
  */
 void font_write_string_centered(coord_t pos_x, coord_t y, color_t col, char* str, font_t* font, gbuffer_t dst);
 
+/* --------------------------- direct output -------------------------- */
+/**
+ * @brief  Draws a string straight to the LCD (no framebuffer needed).
+ *
+ * @note   Physical coordinates and RGB565 colors. The characters are drawn
+ *         opaque (including the column between them) and are sent in
+ *         slices of at most FONT_LCD_CELL_PIXELS pixels.
+ *
+ * @param[in] pos_x: x coordinate of the upper left corner
+ * @param[in] pos_y: y coordinate of the upper left corner
+ * @param[in] col: color of the characters
+ * @param[in] bg: background color
+ * @param[in] str: string to draw
+ * @param[in] font: ptr to a font in memory
+ */
+void font_write_string_lcd(coord_t pos_x, coord_t pos_y, uint16_t col, uint16_t bg, char* str, font_t* font);
+
+/* -------------------------- packed buffers -------------------------- */
+// Same as above for packed buffers (4, 2 and 1 bpp), col is a palette index
+void font_put_char(coord_t pos_x, coord_t pos_y, color8_t col, char c, font_t* font, gbuffer_packed_t dst);
+void font_write_string(coord_t pos_x, coord_t pos_y, color8_t col, char* str, font_t* font, gbuffer_packed_t dst);
+void font_write_string_centered(coord_t pos_x, coord_t y, color8_t col, char* str, font_t* font, gbuffer_packed_t dst);
+
 
 #endif //FONTS_H
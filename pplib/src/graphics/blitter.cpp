@@ -38,8 +38,10 @@ void blit_buf(coord_t kx,       // coordinates of upper left corner
 
   uint16_t srcBufWidth = gbuf_get_width(src);
   uint16_t srcBufHeight = gbuf_get_height(src);
+  uint16_t srcBufStride = gbuf_get_stride(src);
   uint16_t dstBufWidth = gbuf_get_width(dst);
   uint16_t dstBufHeight = gbuf_get_height(dst);
+  uint16_t dstBufStride = gbuf_get_stride(dst);
 
   // area is out of destination buffer
   if (kx >= dstBufWidth || (kx + srcBufWidth < 0) || ky >= dstBufHeight || (ky + srcBufHeight < 0))
@@ -62,7 +64,7 @@ void blit_buf(coord_t kx,       // coordinates of upper left corner
 
   if (ky < 0) {
     start_y = 0;
-    cpybuf_s += (-ky) * srcBufWidth;
+    cpybuf_s += (-ky) * srcBufStride;
   } else {
     start_y = ky;
   }
@@ -78,7 +80,7 @@ void blit_buf(coord_t kx,       // coordinates of upper left corner
     end_y = ky + srcBufHeight;
 
   // prepare start values
-  uint32_t cpybuf_d = start_y * dstBufWidth + start_x;
+  uint32_t cpybuf_d = start_y * dstBufStride + start_x;
 
   // copy the buffer
   if (alpha == BLIT_NO_ALPHA) {
@@ -89,8 +91,8 @@ void blit_buf(coord_t kx,       // coordinates of upper left corner
         cpybuf_s++;
         cpybuf_d++;
       }
-      cpybuf_s += srcBufWidth - (end_x - start_x);
-      cpybuf_d += dstBufWidth - (end_x - start_x);
+      cpybuf_s += srcBufStride - (end_x - start_x);
+      cpybuf_d += dstBufStride - (end_x - start_x);
     }
   } else {
     for (coord_t y = start_y; y < end_y; y++) {
@@ -101,13 +103,67 @@ void blit_buf(coord_t kx,       // coordinates of upper left corner
         cpybuf_s++;
         cpybuf_d++;
       }
-      cpybuf_s += srcBufWidth - (end_x - start_x);
-      cpybuf_d += dstBufWidth - (end_x - start_x);
+      cpybuf_s += srcBufStride - (end_x - start_x);
+      cpybuf_d += dstBufStride - (end_x - start_x);
     }
   }
 
 }  // blitBuf
 
+void blit_buf(coord_t kx,       // coordinates of upper left corner
+              coord_t ky,
+              int16_t alpha,
+              gbuffer_packed_t src,
+              gbuffer_packed_t dst) {
+
+  if (src.bpp != dst.bpp)
+    return;
+
+  // clip the blitting area to the destination buffer
+  coord_t start_x = kx < 0 ? 0 : kx;
+  coord_t start_y = ky < 0 ? 0 : ky;
+  coord_t end_x = kx + gbuf_get_width(src);
+  coord_t end_y = ky + gbuf_get_height(src);
+
+  if (end_x > gbuf_get_width(dst))
+    end_x = gbuf_get_width(dst);
+
+  if (end_y > gbuf_get_height(dst))
+    end_y = gbuf_get_height(dst);
+
+  if (start_x >= end_x || start_y >= end_y)
+    return;
+
+  uint8_t ppb = 8 / src.bpp;  // pixels per byte
+  uint16_t width = end_x - start_x;
+
+  // both areas start at a byte boundary: whole bytes are copied
+  if (alpha == BLIT_NO_ALPHA && (start_x - kx) % ppb == 0 && start_x % ppb == 0) {
+    uint16_t src_bytes = gbuf_get_line_bytes(src);
+    uint16_t dst_bytes = gbuf_get_line_bytes(dst);
+    uint16_t bytes = width / ppb;
+
+    for (coord_t y = start_y; y < end_y; y++) {
+      memcpy(&dst.data[y * dst_bytes + start_x / ppb],
+             &src.data[(y - ky) * src_bytes + (start_x - kx) / ppb], bytes);
+
+      for (coord_t x = start_x + bytes * ppb; x < end_x; x++)
+        gbuf_put_packed(dst, x, y, gbuf_get_packed(src, x - kx, y - ky));
+    }
+
+    return;
+  }
+
+  for (coord_t y = start_y; y < end_y; y++)
+    for (coord_t x = start_x; x < end_x; x++) {
+      color8_t c = gbuf_get_packed(src, x - kx, y - ky);
+
+      if (c != alpha)
+        gbuf_put_packed(dst, x, y, c);
+    }
+
+}  // blit_buf
+
 #if !PICO_NO_HARDWARE
 /**
  * @details  Blits a buffer with rotation and zooming using HW acceleration of the interpolater
@@ -136,6 +192,13 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   // which then get rounded down...
   uint16_t width_log = round(log2(width));
   uint16_t height_log = round(log2(height));
+  // lines of a view are further apart than its width, a power of 2 as well
+  uint16_t stride = gbuf_get_stride(src);
+
+  if (stride & (stride - 1))
+    return;
+
+  uint16_t stride_log = round(log2(stride));
 
   // shift and mask need to take color depth into account.
   // Because if color depth is two bytes per pixel then 
@@ -154,9 +217,9 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   interp_config_set_mask(&lane0_cfg, INTERP_COL_DEPTH, INTERP_COL_DEPTH + (width_log - 1));
   interp_config_set_add_raw(&lane0_cfg, true);  // Add full accumulator to base with each POP
   interp_config lane1_cfg = interp_default_config();
-  interp_config_set_shift(&lane1_cfg, UNIT_LSB - (INTERP_COL_DEPTH + width_log));
-  // the masking is so that you don't run out of the image's area: width_log + height_log in log2 means: width_log * height_log
-  interp_config_set_mask(&lane1_cfg, INTERP_COL_DEPTH + width_log, INTERP_COL_DEPTH + (width_log + height_log - 1));
+  interp_config_set_shift(&lane1_cfg, UNIT_LSB - (INTERP_COL_DEPTH + stride_log));
+  // the masking is so that you don't run out of the image's area: stride_log + height_log in log2 means: stride_log * height_log
+  interp_config_set_mask(&lane1_cfg, INTERP_COL_DEPTH + stride_log, INTERP_COL_DEPTH + (stride_log + height_log - 1));
   interp_config_set_add_raw(&lane1_cfg, true);
 
   interp_set_config(interp0, 0, &lane0_cfg);
@@ -219,7 +282,7 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   int32_t accum0_start = rotate[1] * (-ky + vis_size / 2 + py) - rotate[0] * px + pivot_x * (1 << UNIT_LSB) + shift_x * rotate[0];
   int32_t accum1_start = rotate[3] * (-ky + vis_size / 2 + py) - rotate[2] * px + pivot_y * (1 << UNIT_LSB) + shift_x * rotate[2];
 
-  uint16_t dst_width = gbuf_get_width(dst);
+  uint16_t dst_width = gbuf_get_stride(dst);
 
   for (int y = start_y; y < end_y; ++y) {
     interp0->accum[0] = rotate[1] * y + accum0_start;
@@ -248,6 +311,13 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   // which then get rounded down...
   uint16_t width_log = round(log2(width));
   uint16_t height_log = round(log2(height));
+  // lines of a view are further apart than its width, a power of 2 as well
+  uint16_t stride = gbuf_get_stride(src);
+
+  if (stride & (stride - 1))
+    return;
+
+  uint16_t stride_log = round(log2(stride));
 
   // shift and mask need to take color depth into account.
   // Because if color depth is two bytes per pixel then
@@ -267,9 +337,9 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   interp_config_set_mask(&lane0_cfg, INTERP_COL_DEPTH, INTERP_COL_DEPTH + (width_log - 1));
   interp_config_set_add_raw(&lane0_cfg, true);  // Add full accumulator to base with each POP
   interp_config lane1_cfg = interp_default_config();
-  interp_config_set_shift(&lane1_cfg, UNIT_LSB - (INTERP_COL_DEPTH + width_log));
-  // the masking is so that you don't run out of the image's area: width_log + height_log in log2 means: width_log * height_log
-  interp_config_set_mask(&lane1_cfg, INTERP_COL_DEPTH + width_log, INTERP_COL_DEPTH + (width_log + height_log - 1));
+  interp_config_set_shift(&lane1_cfg, UNIT_LSB - (INTERP_COL_DEPTH + stride_log));
+  // the masking is so that you don't run out of the image's area: stride_log + height_log in log2 means: stride_log * height_log
+  interp_config_set_mask(&lane1_cfg, INTERP_COL_DEPTH + stride_log, INTERP_COL_DEPTH + (stride_log + height_log - 1));
   interp_config_set_add_raw(&lane1_cfg, true);
 
   interp_set_config(interp0, 0, &lane0_cfg);
@@ -328,7 +398,7 @@ void blit_buf(coord_t kx,       // x-coord where to blit the of CENTER of the im
   int32_t accum0_start = -zoom[0] * px + pivot_x * (1 << UNIT_LSB) + shift_x * zoom[0];
   int32_t accum1_start = zoom[1] * (-ky + ry / 2 + py) + pivot_y * (1 << UNIT_LSB);
 
-  uint32_t dst_width = gbuf_get_width(dst);
+  uint32_t dst_width = gbuf_get_stride(dst);
 
   for (int y = start_y; y < end_y; ++y) {
     interp0->accum[0] = accum0_start;
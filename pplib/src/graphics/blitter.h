@@ -54,6 +54,26 @@ void blit_buf(coord_t kx,
               gbuffer_t src,
               gbuffer_t dst);
 
+/**
+ * @brief  Blits a packed source buffer to a packed destination buffer.
+ *
+ * @note   Both buffers need to have the same color depth (4, 2 or 1 bpp),
+ *         otherwise nothing is drawn. alpha must equal either
+ *         `BLIT_NO_ALPHA` (no alpha channel) or the palette index that
+ *         shall be transparent
+ *
+ * @param[in] kx: x coordinate of the upper left corner
+ * @param[in] ky: y coordinate of the upper left corner
+ * @param[in] alpha: palette index which is NOT being drawn (`BLIT_NO_ALPHA` for no transparency)
+ * @param[in] src: the source buffer that is supposed to be blitted
+ * @param[in] dst: destination buffer where the source buffer shall be blitted to
+ */
+void blit_buf(coord_t kx,
+              coord_t ky,
+              int16_t alpha,
+              gbuffer_packed_t src,
+              gbuffer_packed_t dst);
+
 #if !PICO_NO_HARDWARE
 /**
  * @brief  Blits a source buffer to a destination buffer and rotates/zoomes it.
@@ -64,6 +84,9 @@ void blit_buf(coord_t kx,
  *         fast it's still slower than blitting without rotation/zooming.
  *         Also there are special requirements to the source buffer in order to
  *         rotate properly. For more details see online description.
+ *         The width and the height of the image must be a power of 2. If the
+ *         image is a view, the lines of the underlying buffer must be a power
+ *         of 2 apart as well, otherwise nothing is drawn.
  *
  * @param[in] kx: x-coord where to blit the of CENTER of the image
  * @param[in] ky: y-coord where to blit the of CENTER of the image
@@ -88,6 +111,9 @@ void blit_buf(coord_t kx,
  *         color that shall be transparent
  *         This uses the RP2040's "interpolator". While this makes it pretty
  *         fast it's still slower than blitting without zooming.
+ *         The width and the height of the image must be a power of 2. If the
+ *         image is a view, the lines of the underlying buffer must be a power
+ *         of 2 apart as well, otherwise nothing is drawn.
  *
  * @param[in] kx: x-coord where to blit the of CENTER of the image
  * @param[in] ky: y-coord where to blit the of CENTER of the image
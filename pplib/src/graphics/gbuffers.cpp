@@ -45,12 +45,12 @@ gbuf_results_t gbuf_alloc(gbuffer8_t* buf, uint16_t width, uint16_t height) {
   if (buf->data == NULL)
     return BUF_ERR_NO_RAM;
 
-  for (uint32_t i = 0; i < width * height; i++)
-    buf->data[i] = 0;
+  memset(buf->data, 0, width * height);
 
   buf->width = width;
   buf->height = height;
   buf->bpp = 8;
+  buf->stride = 0;
 
   return BUF_SUCCESS;
 }
@@ -61,12 +61,12 @@ gbuf_results_t gbuf_alloc(gbuffer16_t* buf, uint16_t width, uint16_t height) {
   if (buf->data == NULL)
     return BUF_ERR_NO_RAM;
 
-  for (uint32_t i = 0; i < width * height; i++)
-    buf->data[i] = 0;
+  memset(buf->data, 0, width * height * 2);
 
   buf->width = width;
   buf->height = height;
   buf->bpp = 16;
+  buf->stride = 0;
 
   return BUF_SUCCESS;
 }
@@ -86,3 +86,363 @@ void gbuf_free(gbuffer8_t buf) {
 void gbuf_free(gbuffer16_t buf) {
   free((void*)buf.data);
 }
+
+/* ------------------------------ views ----------------------------- */
+// The view starts at (x, y) of the buffer and keeps its stride, so drawing
+// into the view changes the area of the buffer (clipped at the view).
+gbuf_results_t gbuf_view(gbuffer8_t* view, gbuffer8_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height) {
+  if (x < 0 || y < 0 || x + width > buf.width || y + height > buf.height)
+    return BUF_ERR_INVALID_AREA;
+
+  view->bpp = 8;
+  view->width = width;
+  view->height = height;
+  view->stride = gbuf_get_stride(buf);
+  view->data = &buf.data[y * view->stride + x];
+
+  return BUF_SUCCESS;
+}
+
+gbuf_results_t gbuf_view(gbuffer16_t* view, gbuffer16_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height) {
+  if (x < 0 || y < 0 || x + width > buf.width || y + height > buf.height)
+    return BUF_ERR_INVALID_AREA;
+
+  view->bpp = 16;
+  view->width = width;
+  view->height = height;
+  view->stride = gbuf_get_stride(buf);
+  view->data = &buf.data[y * view->stride + x];
+
+  return BUF_SUCCESS;
+}
+
+// the view needs to start at a byte boundary
+gbuf_results_t gbuf_view(gbuffer_packed_t* view, gbuffer_packed_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height) {
+  if (x < 0 || y < 0 || x + width > buf.width || y + height > buf.height || (x * buf.bpp) % 8 != 0)
+    return BUF_ERR_INVALID_AREA;
+
+  view->bpp = buf.bpp;
+  view->width = width;
+  view->height = height;
+  view->stride = gbuf_get_stride(buf);
+  view->data = &buf.data[y * view->stride + x * buf.bpp / 8];
+
+  return BUF_SUCCESS;
+}
+
+/* ------------------------- packed buffers ------------------------ */
+uint16_t gbuf_get_width(gbuffer_packed_t buf) {
+  return buf.width;
+}
+
+uint16_t gbuf_get_height(gbuffer_packed_t buf) {
+  return buf.height;
+}
+
+// bytes from one line to the next (lines start at a byte boundary)
+uint16_t gbuf_get_line_bytes(gbuffer_packed_t buf) {
+  return gbuf_get_stride(buf);
+}
+
+gbuf_results_t gbuf_alloc(gbuffer_packed_t* buf, uint16_t width, uint16_t height, uint8_t bpp) {
+  if (bpp != 4 && bpp != 2 && bpp != 1)
+    return BUF_ERR_INVALID_BPP;
+
+  uint32_t size = ((width * bpp + 7) / 8) * height;
+
+  buf->data = (uint8_t*)aligned_alloc(4, size + 4 - size % 4);
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  memset(buf->data, 0, size);
+
+  buf->width = width;
+  buf->height = height;
+  buf->bpp = bpp;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+uint8_t* gbuf_get_dat_ptr(gbuffer_packed_t buf) {
+  return buf.data;
+}
+
+void gbuf_free(gbuffer_packed_t buf) {
+  free((void*)buf.data);
+}
+
+/* ----------------------------- arenas ---------------------------- */
+// bytes taken by a buffer (whole words, which keeps every buffer word aligned
+// for the DMA)
+uint32_t gbuf_mem_size(uint16_t width, uint16_t height, uint8_t bpp) {
+  return ((((uint32_t) width * bpp + 7) / 8 * height) + 3) & ~3;
+}
+
+// The memory is taken from the heap once, preferably right at the start
+// (before the heap becomes fragmented).
+gbuf_results_t gbuf_arena_init(gbuf_arena_t* arena, uint32_t size) {
+  size = (size + 3) & ~3;
+
+  arena->mem = (uint8_t*)aligned_alloc(4, size);
+  arena->size = 0;
+  arena->used = 0;
+  arena->high_water = 0;
+
+  if (arena->mem == NULL)
+    return BUF_ERR_NO_RAM;
+
+  arena->size = size;
+
+  return BUF_SUCCESS;
+}
+
+void gbuf_arena_free(gbuf_arena_t* arena) {
+  free((void*)arena->mem);
+
+  arena->mem = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
+
+// releases all buffers of the arena at once
+void gbuf_arena_reset(gbuf_arena_t* arena) {
+  arena->used = 0;
+}
+
+// takes the next size bytes (zeroed) of the arena
+void* gbuf_arena_take(gbuf_arena_t* arena, uint32_t size) {
+  if (size > arena->size - arena->used)
+    return NULL;
+
+  void* p = arena->mem + arena->used;
+
+  arena->used += size;
+
+  if (arena->used > arena->high_water)
+    arena->high_water = arena->used;
+
+  memset(p, 0, size);
+
+  return p;
+}
+
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer8_t* buf, uint16_t width, uint16_t height) {
+  buf->data = (color8_t*)gbuf_arena_take(arena, gbuf_mem_size(width, height, 8));
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = width;
+  buf->height = height;
+  buf->bpp = 8;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer16_t* buf, uint16_t width, uint16_t height) {
+  buf->data = (color16_t*)gbuf_arena_take(arena, gbuf_mem_size(width, height, 16));
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = width;
+  buf->height = height;
+  buf->bpp = 16;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer_packed_t* buf, uint16_t width, uint16_t height, uint8_t bpp) {
+  if (bpp != 4 && bpp != 2 && bpp != 1)
+    return BUF_ERR_INVALID_BPP;
+
+  buf->data = (uint8_t*)gbuf_arena_take(arena, gbuf_mem_size(width, height, bpp));
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = width;
+  buf->height = height;
+  buf->bpp = bpp;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+uint32_t gbuf_arena_get_used(gbuf_arena_t* arena) {
+  return arena->used;
+}
+
+uint32_t gbuf_arena_get_high_water(gbuf_arena_t* arena) {
+  return arena->high_water;
+}
+
+/* ------------------------------ pools ----------------------------- */
+// The free buffers form a list, the index of the next free buffer is kept in
+// the first word of each free buffer. A bitmap of the buffers in use follows
+// the buffers.
+gbuf_results_t gbuf_pool_init(gbuf_pool_t* pool, uint16_t width, uint16_t height, uint8_t bpp, uint16_t num_bufs) {
+  if (bpp != 16 && bpp != 8 && bpp != 4 && bpp != 2 && bpp != 1)
+    return BUF_ERR_INVALID_BPP;
+
+  pool->buf_size = gbuf_mem_size(width, height, bpp);
+
+  // room for the link of the free list
+  if (pool->buf_size < 4)
+    pool->buf_size = 4;
+
+  uint32_t map_bytes = (num_bufs + 7) / 8;
+
+  pool->mem = (uint8_t*)aligned_alloc(4, (pool->buf_size * num_bufs + map_bytes + 3) & ~3);
+  pool->num_bufs = 0;
+  pool->used = 0;
+  pool->high_water = 0;
+  pool->free_head = -1;
+
+  if (pool->mem == NULL)
+    return BUF_ERR_NO_RAM;
+
+  pool->width = width;
+  pool->height = height;
+  pool->bpp = bpp;
+  pool->num_bufs = num_bufs;
+  pool->in_use = pool->mem + pool->buf_size * num_bufs;
+
+  memset(pool->in_use, 0, map_bytes);
+
+  for (int32_t h = num_bufs - 1; h >= 0; h--) {
+    *(int32_t*)(pool->mem + h * pool->buf_size) = pool->free_head;
+    pool->free_head = h;
+  }
+
+  return BUF_SUCCESS;
+}
+
+void gbuf_pool_free(gbuf_pool_t* pool) {
+  free((void*)pool->mem);
+
+  pool->mem = NULL;
+  pool->num_bufs = 0;
+  pool->used = 0;
+  pool->free_head = -1;
+  pool->in_use = NULL;
+}
+
+// takes a free buffer (zeroed) of the pool
+void* gbuf_pool_take(gbuf_pool_t* pool, uint8_t bpp) {
+  if (bpp != pool->bpp || pool->free_head < 0)
+    return NULL;
+
+  int32_t h = pool->free_head;
+  uint8_t* p = pool->mem + h * pool->buf_size;
+
+  pool->free_head = *(int32_t*)p;
+  pool->in_use[h / 8] |= 1 << (h % 8);
+
+  if (++pool->used > pool->high_water)
+    pool->high_water = pool->used;
+
+  memset(p, 0, pool->buf_size);
+
+  return p;
+}
+
+// Buffers not taken from the pool (including views into a buffer of the
+// pool) and buffers already released are ignored.
+void gbuf_pool_give(gbuf_pool_t* pool, void* data) {
+  uint8_t* p = (uint8_t*)data;
+
+  if (p < pool->mem || p >= pool->mem + pool->num_bufs * pool->buf_size)
+    return;
+
+  uint32_t ofs = p - pool->mem;
+
+  if (ofs % pool->buf_size != 0)
+    return;
+
+  int32_t h = ofs / pool->buf_size;
+
+  if (!(pool->in_use[h / 8] & (1 << (h % 8))))
+    return;
+
+  pool->in_use[h / 8] &= ~(1 << (h % 8));
+
+  *(int32_t*)p = pool->free_head;
+  pool->free_head = h;
+  pool->used--;
+}
+
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer8_t* buf) {
+  if (pool->bpp != 8)
+    return BUF_ERR_INVALID_BPP;
+
+  buf->data = (color8_t*)gbuf_pool_take(pool, 8);
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = pool->width;
+  buf->height = pool->height;
+  buf->bpp = 8;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer16_t* buf) {
+  if (pool->bpp != 16)
+    return BUF_ERR_INVALID_BPP;
+
+  buf->data = (color16_t*)gbuf_pool_take(pool, 16);
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = pool->width;
+  buf->height = pool->height;
+  buf->bpp = 16;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer_packed_t* buf) {
+  if (pool->bpp > 4)
+    return BUF_ERR_INVALID_BPP;
+
+  buf->data = (uint8_t*)gbuf_pool_take(pool, pool->bpp);
+
+  if (buf->data == NULL)
+    return BUF_ERR_NO_RAM;
+
+  buf->width = pool->width;
+  buf->height = pool->height;
+  buf->bpp = pool->bpp;
+  buf->stride = 0;
+
+  return BUF_SUCCESS;
+}
+
+void gbuf_pool_release(gbuf_pool_t* pool, gbuffer8_t buf) {
+  gbuf_pool_give(pool, buf.data);
+}
+
+void gbuf_pool_release(gbuf_pool_t* pool, gbuffer16_t buf) {
+  gbuf_pool_give(pool, buf.data);
+}
+
+void gbuf_pool_release(gbuf_pool_t* pool, gbuffer_packed_t buf) {
+  gbuf_pool_give(pool, buf.data);
+}
+
+uint16_t gbuf_pool_get_used(gbuf_pool_t* pool) {
+  return pool->used;
+}
+
+uint16_t gbuf_pool_get_high_water(gbuf_pool_t* pool) {
+  return pool->high_water;
+}
@@ -27,13 +27,42 @@
 /* ======================== definitions ========================= */
 #define BUF_COLORDEPTH_8 8
 #define BUF_COLORDEPTH_16 16
+#define BUF_COLORDEPTH_4 4     // packed (gbuffer_packed_t)
+#define BUF_COLORDEPTH_2 2
+#define BUF_COLORDEPTH_1 1
 
 // Errors
 typedef enum {
   BUF_SUCCESS = 0,      /**< @brief No error */
   BUF_ERR_NO_RAM = -1,  /**< @brief Insufficient RAM */
+  BUF_ERR_INVALID_BPP = -2,  /**< @brief Color depth not supported by the buffer type */
+  BUF_ERR_INVALID_AREA = -3, /**< @brief Area not within the buffer */
 } gbuf_results_t ; 
 
+// Arena: buffers are carved out of a single block of memory one after
+// another and are all released at once (e.g. when a level is unloaded).
+typedef struct {
+  uint8_t* mem;
+  uint32_t size;          /**< @brief bytes */
+  uint32_t used;          /**< @brief bytes handed out since the last reset */
+  uint32_t high_water;    /**< @brief max. number of bytes used at once */
+} gbuf_arena_t;
+
+// Pool: a fixed number of buffers of the same size and color depth (e.g.
+// sprites), which are taken and released individually.
+typedef struct {
+  uint8_t* mem;
+  uint32_t buf_size;      /**< @brief bytes per buffer (multiple of 4) */
+  uint16_t width;
+  uint16_t height;
+  uint8_t bpp;
+  uint16_t num_bufs;
+  uint16_t used;          /**< @brief buffers handed out */
+  uint16_t high_water;    /**< @brief max. number of buffers used at once */
+  int32_t free_head;      /**< @brief first free buffer (-1 if none) */
+  uint8_t* in_use;        /**< @brief one bit per buffer (behind the buffers) */
+} gbuf_pool_t;
+
 /* ==================== function declarations =================== */
 uint16_t       gbuf_get_width(gbuffer8_t buf);
 uint16_t       gbuf_get_width(gbuffer16_t buf);
@@ -46,4 +75,70 @@ color16_t*     gbuf_get_dat_ptr(gbuffer16_t buf);
 void           gbuf_free(gbuffer8_t buf);
 void           gbuf_free(gbuffer16_t buf);
 
+/* ------------------------------ views ----------------------------- */
+// a view shares the data of the buffer (it must not be freed)
+gbuf_results_t gbuf_view(gbuffer8_t* view, gbuffer8_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height);
+gbuf_results_t gbuf_view(gbuffer16_t* view, gbuffer16_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height);
+gbuf_results_t gbuf_view(gbuffer_packed_t* view, gbuffer_packed_t buf, coord_t x, coord_t y, uint16_t width, uint16_t height);
+
+/* ------------------------- packed buffers ------------------------ */
+uint16_t       gbuf_get_width(gbuffer_packed_t buf);
+uint16_t       gbuf_get_height(gbuffer_packed_t buf);
+uint16_t       gbuf_get_line_bytes(gbuffer_packed_t buf);
+gbuf_results_t gbuf_alloc(gbuffer_packed_t* buf, uint16_t width, uint16_t height, uint8_t bpp);
+uint8_t*       gbuf_get_dat_ptr(gbuffer_packed_t buf);
+void           gbuf_free(gbuffer_packed_t buf);
+
+/* ----------------------------- arenas ---------------------------- */
+gbuf_results_t gbuf_arena_init(gbuf_arena_t* arena, uint32_t size);
+void           gbuf_arena_free(gbuf_arena_t* arena);
+void           gbuf_arena_reset(gbuf_arena_t* arena);
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer8_t* buf, uint16_t width, uint16_t height);
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer16_t* buf, uint16_t width, uint16_t height);
+gbuf_results_t gbuf_arena_alloc(gbuf_arena_t* arena, gbuffer_packed_t* buf, uint16_t width, uint16_t height, uint8_t bpp);
+uint32_t       gbuf_arena_get_used(gbuf_arena_t* arena);
+uint32_t       gbuf_arena_get_high_water(gbuf_arena_t* arena);
+
+/* ------------------------------ pools ----------------------------- */
+gbuf_results_t gbuf_pool_init(gbuf_pool_t* pool, uint16_t width, uint16_t height, uint8_t bpp, uint16_t num_bufs);
+void           gbuf_pool_free(gbuf_pool_t* pool);
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer8_t* buf);
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer16_t* buf);
+gbuf_results_t gbuf_pool_alloc(gbuf_pool_t* pool, gbuffer_packed_t* buf);
+void           gbuf_pool_release(gbuf_pool_t* pool, gbuffer8_t buf);
+void           gbuf_pool_release(gbuf_pool_t* pool, gbuffer16_t buf);
+void           gbuf_pool_release(gbuf_pool_t* pool, gbuffer_packed_t buf);
+uint16_t       gbuf_pool_get_used(gbuf_pool_t* pool);
+uint16_t       gbuf_pool_get_high_water(gbuf_pool_t* pool);
+
+// distance from one line to the next (pixels, bytes for packed buffers)
+inline uint16_t gbuf_get_stride(gbuffer8_t buf) {
+  return buf.stride ? buf.stride : buf.width;
+}
+
+inline uint16_t gbuf_get_stride(gbuffer16_t buf) {
+  return buf.stride ? buf.stride : buf.width;
+}
+
+inline uint16_t gbuf_get_stride(gbuffer_packed_t buf) {
+  return buf.stride ? buf.stride : (buf.width * buf.bpp + 7) >> 3;
+}
+
+// pixel access without range checking (used by the drawing functions)
+inline color8_t gbuf_get_packed(gbuffer_packed_t buf, coord_t x, coord_t y) {
+  uint32_t bit = x * buf.bpp;
+  uint8_t shift = 8 - buf.bpp - (bit & 7);
+
+  return (buf.data[y * gbuf_get_stride(buf) + (bit >> 3)] >> shift) & ((1 << buf.bpp) - 1);
+}
+
+inline void gbuf_put_packed(gbuffer_packed_t buf, coord_t x, coord_t y, color8_t color) {
+  uint32_t bit = x * buf.bpp;
+  uint8_t shift = 8 - buf.bpp - (bit & 7);
+  uint8_t mask = ((1 << buf.bpp) - 1) << shift;
+  uint8_t* p = &buf.data[y * gbuf_get_stride(buf) + (bit >> 3)];
+
+  *p = (*p & ~mask) | ((color << shift) & mask);
+}
+
 #endif //GBUFFERS_H
@@ -30,7 +30,7 @@
 void draw_pixel(coord_t x, coord_t y, color_t color, gbuffer_t dst) {
 
   if (x >= 0 && x < gbuf_get_width(dst) && y >= 0 && y < gbuf_get_height(dst))
-    dst.data[y * gbuf_get_width(dst) + x] = color;
+    dst.data[y * gbuf_get_stride(dst) + x] = color;
 }
 
 //void __scratch_x("DrawLine") DrawLine(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gbuffer_t dst) {
@@ -38,7 +38,7 @@ void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
 
   uint16_t bufwidth = gbuf_get_width(dst);
   uint16_t bufheight = gbuf_get_height(dst);
-  uint32_t bufsize = bufwidth * bufheight;
+  uint16_t bufstride = gbuf_get_stride(dst);
 
   int16_t x = x1, y = y1, dx, dy, incx, incy, err;
 
@@ -64,19 +64,19 @@ void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
     // horizontal lines cannot be drawn by loop
     if (y1 == y2) {
       if (x1 < x2) {
-        for (int32_t h = x1 + y1 * bufwidth; h < x2 + 1 + y1 * bufwidth; h++)
+        for (int32_t h = x1 + y1 * bufstride; h < x2 + 1 + y1 * bufstride; h++)
           dst.data[h] = color;
       } else {
-        for (int32_t h = x2 + y1 * bufwidth; h < x1 + 1 + y1 * bufwidth; h++)
+        for (int32_t h = x2 + y1 * bufstride; h < x1 + 1 + y1 * bufstride; h++)
           dst.data[h] = color;
       }
       return;
     }
 
-    incy *= bufwidth;  // direct pointer address calculation
+    incy *= bufstride;  // direct pointer address calculation
 
-    color_t *target_p = &dst.data[y2 * bufwidth + x2];
-    color_t *buf_ptr = &dst.data[y * bufwidth + x];
+    color_t *target_p = &dst.data[y2 * bufstride + x2];
+    color_t *buf_ptr = &dst.data[y * bufstride + x];
 
     if (dx >= dy) {
       dy <<= 1;
@@ -112,15 +112,16 @@ void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
 
     // horizontal lines cannot be drawn by loop
     if (y1 == y2) {
-      if (x1 < x2) {
-        for (int32_t h = x1 + y1 * bufwidth; h < x2 + 1 + y1 * bufwidth; h++)
-          if (h >= 0 && h < bufsize && ((h - bufwidth * y) < bufwidth) && ((h - bufwidth * y) >= 0))
-            dst.data[h] = color;
-      } else {
-        for (int32_t h = x2 + y1 * bufwidth; h < x1 + 1 + y1 * bufwidth; h++)
-          if (h >= 0 && h < bufsize && ((h - bufwidth * y) < bufwidth) && ((h - bufwidth * y) >= 0))
-            dst.data[h] = color;
-      }
+      if (y1 < 0 || y1 >= bufheight)
+        return;
+      coord_t xs = x1 < x2 ? x1 : x2;
+      coord_t xe = x1 < x2 ? x2 : x1;
+      if (xs < 0)
+        xs = 0;
+      if (xe >= bufwidth)
+        xe = bufwidth - 1;
+      for (int32_t h = xs + y1 * bufstride; h < xe + 1 + y1 * bufstride; h++)
+        dst.data[h] = color;
       return;
     }
 
@@ -131,7 +132,7 @@ void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
       dx *= 2;
       while (x != x2) {
         if (x >= 0 && x < bufwidth && y >= 0 && y < bufheight)
-          dst.data[y * bufwidth + x] = color;
+          dst.data[y * bufstride + x] = color;
         if (err >= 0) {
           y += incy;
           err -= dx;
@@ -147,7 +148,7 @@ void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
       dy *= 2;
       while (y != y2) {
         if (x >= 0 && x < bufwidth && y >= 0 && y < bufheight)
-          dst.data[y * bufwidth + x] = color;
+          dst.data[y * bufstride + x] = color;
         if (err >= 0) {
           x += incx;
           err -= dy;
@@ -286,34 +287,11 @@ void draw_line_interp(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t co
 #endif  // DrawLineInterp
 #endif
 
-void sanitize_rect(coord_t *x1, coord_t *y1, coord_t *x2, coord_t *y2, gbuffer_t dst) {
-  uint16_t width = gbuf_get_width(dst) - 1;
-  uint16_t height = gbuf_get_height(dst) - 1;
-  
-  // range checking
-  if (*x1 < 0)
-    *x1 = 0;
-
-  if (*x1 > width)
-    *x1 = width;
-
-  if (*x2 < 0)
-    *x2 = 0;
-
-  if (*x2 > width)
-    *x2 = width;
-
-  if (*y1 < 0)
-    *y1 = 0;
-
-  if (*y1 > height)
-    *y1 = height;
-
-  if (*y2 < 0)
-    *y2 = 0;
-
-  if (*y2 > height)
-    *y2 = height;
+// Sorts the corners and clips the rectangle to a buffer of the given size.
+// Returns false if the rectangle lies completely outside of the buffer.
+bool sanitize_rect(coord_t *x1, coord_t *y1, coord_t *x2, coord_t *y2, uint16_t buf_width, uint16_t buf_height) {
+  coord_t width = buf_width - 1;
+  coord_t height = buf_height - 1;
 
   if (*x1 > *x2) {
     coord_t tmp;
@@ -328,44 +306,138 @@ void sanitize_rect(coord_t *x1, coord_t *y1, coord_t *x2, coord_t *y2, gbuffer_t
     *y1 = *y2;
     *y2 = tmp;
   }
+
+  // completely off the buffer (e.g. above or below a strip)
+  if (*x2 < 0 || *x1 > width || *y2 < 0 || *y1 > height)
+    return false;
+
+  // range checking
+  if (*x1 < 0)
+    *x1 = 0;
+
+  if (*x2 > width)
+    *x2 = width;
+
+  if (*y1 < 0)
+    *y1 = 0;
+
+  if (*y2 > height)
+    *y2 = height;
+
+  return true;
+}
+
+bool sanitize_rect(coord_t *x1, coord_t *y1, coord_t *x2, coord_t *y2, gbuffer_t dst) {
+  return sanitize_rect(x1, y1, x2, y2, gbuf_get_width(dst), gbuf_get_height(dst));
 }
 
 void draw_rect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gbuffer_t dst) {
-  sanitize_rect(&x1, &y1, &x2, &y2, dst);
+  if (!sanitize_rect(&x1, &y1, &x2, &y2, dst))
+    return;
 
-  uint16_t buf_width = gbuf_get_width(dst);
+  uint16_t buf_stride = gbuf_get_stride(dst);
 
-  //jumpy  off by one?!
   for (uint16_t y = y1; y < (y2 + 1); y++)
     for (uint16_t x = x1; x < (x2 + 1); x++)
-      dst.data[y * buf_width + x] = color;
+      dst.data[y * buf_stride + x] = color;
 }
 
 void draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gbuffer_t dst) {
-  sanitize_rect(&x1, &y1, &x2, &y2, dst);
+  // the edges of the unclipped rectangle
+  coord_t left = x1 < x2 ? x1 : x2;
+  coord_t right = x1 < x2 ? x2 : x1;
+  coord_t top = y1 < y2 ? y1 : y2;
+  coord_t bottom = y1 < y2 ? y2 : y1;
 
-/*
-  uint16_t rect_width = x2 - x1;
-  uint16_t rect_height = y2 - y1;
-  
-  if ((rect_width == 0) || (rect_height == 0))
-	return;
-*/
-
-  uint16_t buf_width = gbuf_get_width(dst);
-  
-  uint32_t y1_ofs = y1 * buf_width;
-  uint32_t y2_ofs = y2 * buf_width;
-  
+  if (!sanitize_rect(&x1, &y1, &x2, &y2, dst))
+    return;
+
+  uint16_t buf_stride = gbuf_get_stride(dst);
+
+  // edges which have been clipped away are not drawn
   for (uint16_t x = x1; x < (x2 + 1); x++) {
-    dst.data[y1_ofs + x] = color;
-    dst.data[y2_ofs + x] = color;
+    if (top == y1)
+      dst.data[y1 * buf_stride + x] = color;
+    if (bottom == y2)
+      dst.data[y2 * buf_stride + x] = color;
   }
 
   for (uint16_t y = y1; y < (y2 + 1); y++) {
-	uint32_t y_ofs = y * buf_width;
-    dst.data[y_ofs + x1] = color;
-    dst.data[y_ofs + x2] = color;
+    uint32_t y_ofs = y * buf_stride;
+    if (left == x1)
+      dst.data[y_ofs + x1] = color;
+    if (right == x2)
+      dst.data[y_ofs + x2] = color;
   }
-  
+}
+
+/* ------------------------- packed buffers ------------------------ */
+void draw_pixel(coord_t x, coord_t y, color8_t color, gbuffer_packed_t dst) {
+  if (x >= 0 && x < gbuf_get_width(dst) && y >= 0 && y < gbuf_get_height(dst))
+    gbuf_put_packed(dst, x, y, color);
+}
+
+void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst) {
+  coord_t dx = abs(x2 - x1);
+  coord_t dy = -abs(y2 - y1);
+  coord_t incx = (x1 < x2) ? 1 : -1;
+  coord_t incy = (y1 < y2) ? 1 : -1;
+  coord_t err = dx + dy;
+
+  while (true) {
+    draw_pixel(x1, y1, color, dst);
+
+    if (x1 == x2 && y1 == y2)
+      break;
+
+    coord_t e2 = 2 * err;
+
+    if (e2 >= dy) {
+      err += dy;
+      x1 += incx;
+    }
+
+    if (e2 <= dx) {
+      err += dx;
+      y1 += incy;
+    }
+  }
+}
+
+void draw_rect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst) {
+  if (!sanitize_rect(&x1, &y1, &x2, &y2, gbuf_get_width(dst), gbuf_get_height(dst)))
+    return;
+
+  uint8_t ppb = 8 / dst.bpp;  // pixels per byte
+  uint8_t mask = (1 << dst.bpp) - 1;
+  uint8_t pattern = (color & mask) * (0xff / mask);
+  uint16_t line_bytes = gbuf_get_line_bytes(dst);
+
+  // whole bytes inside the rectangle are filled at once
+  coord_t bx1 = (x1 + ppb - 1) / ppb;
+  coord_t bx2 = (x2 + 1) / ppb;
+
+  for (coord_t y = y1; y <= y2; y++) {
+    if (bx1 >= bx2) {
+      for (coord_t x = x1; x <= x2; x++)
+        gbuf_put_packed(dst, x, y, color);
+      continue;
+    }
+
+    for (coord_t x = x1; x < bx1 * ppb; x++)
+      gbuf_put_packed(dst, x, y, color);
+
+    memset(&dst.data[y * line_bytes + bx1], pattern, bx2 - bx1);
+
+    for (coord_t x = bx2 * ppb; x <= x2; x++)
+      gbuf_put_packed(dst, x, y, color);
+  }
+}
+
+void draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst) {
+  // the pixels are clipped individually
+  draw_line(x1, y1, x2, y1, color, dst);
+  draw_line(x1, y2, x2, y2, color, dst);
+  draw_line(x1, y1, x1, y2, color, dst);
+  draw_line(x2, y1, x2, y2, color, dst);
 }
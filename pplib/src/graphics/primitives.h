@@ -32,6 +32,12 @@ void draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gb
 void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gbuffer_t dst);
 void draw_line_interp(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color_t color, gbuffer_t dst);
 
+// Packed buffers (4, 2 and 1 bpp), the color is a palette index
+void draw_pixel(coord_t x, coord_t y, color8_t color, gbuffer_packed_t dst);
+void draw_rect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst);
+void draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst);
+void draw_line(coord_t x1, coord_t y1, coord_t x2, coord_t y2, color8_t color, gbuffer_packed_t dst);
+
 #define swap_coords(x, y) {coord_t temporary_swap_coordinate = x; x = y; y = temporary_swap_coordinate;}
 #define check_coord(x, y) {if (x > y) {swapCoord(x, y)}}
 
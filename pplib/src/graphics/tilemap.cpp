@@ -62,8 +62,18 @@ void tile_blit_rot(coord_t kx,            // start in fb window x
   uint16_t tiles_width_log = round(log2(tiles_width));
   uint16_t tiles_height_log = round(log2(tiles_height));
 
+  // the tile set may be a view into a wider atlas, whose lines need to be a
+  // power of 2 apart as well
+  uint16_t tiles_stride = gbuf_get_stride(*tile_set.image);
+
+  if (tiles_stride & (tiles_stride - 1))
+    return;
+
+  uint16_t tiles_stride_log = round(log2(tiles_stride));
+
   uint16_t buf_width = gbuf_get_width(buf);
   uint16_t buf_height = gbuf_get_height(buf);
+  uint16_t buf_stride = gbuf_get_stride(buf);
 
   interp_config lane0_cfg = interp_default_config();
   
@@ -85,8 +95,8 @@ void tile_blit_rot(coord_t kx,            // start in fb window x
   interp_config_set_mask(&lane0_cfg, 0, tiles_width_log - 1);
   interp_config_set_add_raw(&lane0_cfg, true);
   lane1_cfg = interp_default_config();
-  interp_config_set_shift(&lane1_cfg, BITS_FRACT - tiles_width_log);
-  interp_config_set_mask(&lane1_cfg, tiles_width_log, tiles_width_log + tiles_height_log - 1);
+  interp_config_set_shift(&lane1_cfg, BITS_FRACT - tiles_stride_log);
+  interp_config_set_mask(&lane1_cfg, tiles_stride_log, tiles_stride_log + tiles_height_log - 1);
   interp_config_set_add_raw(&lane1_cfg, true);
 
   interp_set_config(interp1, 0, &lane0_cfg);
@@ -135,7 +145,7 @@ void tile_blit_rot(coord_t kx,            // start in fb window x
   interp1->base[0] = rotate[0] * tiles_width;
   interp1->base[1] = rotate[2] * tiles_height;
 
-  uint32_t tiles_ofs = tiles_width * tiles_height;
+  uint32_t tiles_ofs = tiles_stride * tiles_height;
 
   if (alpha == BLIT_NO_ALPHA) {
     for (int y = start_y ; y < end_y; ++y) {
@@ -147,7 +157,7 @@ void tile_blit_rot(coord_t kx,            // start in fb window x
         for (int x = start_x; x < end_x; ++x) {
             uint8_t t = *(uint8_t *) interp0->pop[2];
             uint16_t c = (uint16_t) interp1->pop[2];
-            buf.data[x + y * buf_width] = tile_set.image->data[t * tiles_ofs + c];
+            buf.data[x + y * buf_stride] = tile_set.image->data[t * tiles_ofs + c];
 	    }
     }
   } else {
@@ -162,7 +172,7 @@ void tile_blit_rot(coord_t kx,            // start in fb window x
           uint32_t c = (uint32_t) interp1->pop[2];
           color_t col = tile_set.image->data[t * tiles_ofs + c];
 		  if (col != alpha)
-			buf.data[x + y * buf_width] = col;
+			buf.data[x + y * buf_stride] = col;
 	  }
     }
   }
@@ -200,6 +210,15 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
   uint16_t tiles_width_log = round(log2(tiles_width));
   uint16_t tiles_height_log = round(log2(tiles_height));
 
+  // the tile set may be a view into a wider atlas, whose lines need to be a
+  // power of 2 apart as well
+  uint16_t tiles_stride = gbuf_get_stride(*tile_set.image);
+
+  if (tiles_stride & (tiles_stride - 1))
+    return;
+
+  uint16_t tiles_stride_log = round(log2(tiles_stride));
+
   interp_config lane0_cfg = interp_default_config();  // The shift is for the fixed point integer <-> float reresentation. 16 bits, so 65536 represent 1
   interp_config_set_shift(&lane0_cfg, BITS_FRACT);  // the masking is so that you don't run out of the image's line area 
   interp_config_set_mask(&lane0_cfg, 0, map_width_log - 1);
@@ -219,8 +238,8 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
   interp_config_set_mask(&lane0_cfg, 0, tiles_width_log - 1);
   interp_config_set_add_raw(&lane0_cfg, true);
   lane1_cfg = interp_default_config();
-  interp_config_set_shift(&lane1_cfg, BITS_FRACT - tiles_width_log);
-  interp_config_set_mask(&lane1_cfg, tiles_width_log, tiles_width_log + tiles_height_log - 1);
+  interp_config_set_shift(&lane1_cfg, BITS_FRACT - tiles_stride_log);
+  interp_config_set_mask(&lane1_cfg, tiles_stride_log, tiles_stride_log + tiles_height_log - 1);
   interp_config_set_add_raw(&lane1_cfg, true);
 
   interp_set_config(interp1, 0, &lane0_cfg);
@@ -256,7 +275,7 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
   float rcos = cosf(pr);
   float rsin = sinf(pr);
 
-  uint32_t tiles_ofs = tiles_width * tiles_height;
+  uint32_t tiles_ofs = tiles_stride * tiles_height;
   
   // Are the px and py positions dependent on pz (which is bad)?
   // TODO: revise
@@ -264,7 +283,7 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
   uint32_t py32 = py * (1 << (BITS_FRACT - tiles_height_log)); // same as / tiles_height
   uint32_t pz32 = (float) pz / 100. * (1 << BITS_FRACT);
  
-  uint16_t fb_width = gbuf_get_width(buf);
+  uint16_t fb_stride = gbuf_get_stride(buf);
  
   for (int y = start_y ; y < end_y ; ++y) {
     int32_t n = pz32 / (y - ky + 1);
@@ -298,7 +317,7 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
 	  for (int x = start_x; x < end_x; ++x) {
           uint8_t t = *(uint8_t *) interp0->pop[2];
           uint16_t c = (uint16_t) interp1->pop[2];
-          buf.data[x + y * fb_width] = tile_set.image->data[t * tiles_ofs + c];
+          buf.data[x + y * fb_stride] = tile_set.image->data[t * tiles_ofs + c];
 	  }
 	} else {
 	  for (int x = start_x; x < end_x; ++x) {
@@ -306,7 +325,7 @@ void tile_blit_mode7(coord_t kx,           // start in fb window x
           uint16_t c = (uint16_t) interp1->pop[2];
           color_t col = tile_set.image->data[t * tiles_ofs + c];
 		  if (col != alpha)
-            buf.data[x + y * fb_width] = col;
+            buf.data[x + y * fb_stride] = col;
 	  }
 	}
   }
@@ -12,6 +12,11 @@
 
 #include <Arduino.h>
 #include "ili9341_drv.h"
+#include "../lcd_if/lcdcom.h"
+
+#ifdef LCD_BUS_RGB444
+#error The ILI9341 does not support the 12 bit (RGB444) bus format
+#endif
 
 /* ==================== forward declarations ==================== */
 void lcd_send_dat_byte(uint8_t cmd);
@@ -19,6 +24,13 @@ void lcd_send_cmd_byte(uint8_t cmd);
 void set_rs(byte value);
 void set_rst(byte value);
 
+/* ==================== definitions ==================== */
+// CASET, PASET and RAMWR (with parameters)
+#define LCD_SET_ADDR_LIST_SIZE 11
+
+// max. number of entries sent at once during the controller setup
+#define LCD_INIT_LIST_SIZE 128
+
 /* ==================== functions ==================== */
 void lcd_enable_te() {
   lcd_send_cmd_byte(ILI9341_TEON);
@@ -33,8 +45,74 @@ bool lcd_get_vblank() {
   return digitalRead(PIN_LCD_TE);
 }
 
+// fixed top area, scrolling area and fixed bottom area (in lines of the
+// controller, the sum must equal its number of lines)
+void lcd_set_scroll_area(uint16_t top, uint16_t height, uint16_t bottom) {
+  uint16_t list_buf[8];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 8);
+
+  lcd_cmdlist_cmd(&list, ILI9341_VSCRDEF);
+  lcd_cmdlist_dat(&list, top >> 8);
+  lcd_cmdlist_dat(&list, top & 0xff);
+  lcd_cmdlist_dat(&list, height >> 8);
+  lcd_cmdlist_dat(&list, height & 0xff);
+  lcd_cmdlist_dat(&list, bottom >> 8);
+  lcd_cmdlist_dat(&list, bottom & 0xff);
+
+  lcd_cmdlist_send(&list);
+}
+
+// line of the controller's memory shown at the top of the scrolling area
+void lcd_set_scroll_start(uint16_t line) {
+  uint16_t list_buf[4];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 4);
+
+  lcd_cmdlist_cmd(&list, ILI9341_VSCRSADD);
+  lcd_cmdlist_dat(&list, line >> 8);
+  lcd_cmdlist_dat(&list, line & 0xff);
+
+  lcd_cmdlist_send(&list);
+}
+
+// lines of the controller shown in partial mode (the others are blanked),
+// enters partial mode
+void lcd_set_partial_area(uint16_t first, uint16_t last) {
+  uint16_t list_buf[6];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 6);
+
+  lcd_cmdlist_cmd(&list, ILI9341_PTLAR);
+  lcd_cmdlist_dat(&list, first >> 8);
+  lcd_cmdlist_dat(&list, first & 0xff);
+  lcd_cmdlist_dat(&list, last >> 8);
+  lcd_cmdlist_dat(&list, last & 0xff);
+  lcd_cmdlist_cmd(&list, ILI9341_PTLON);
+
+  lcd_cmdlist_send(&list);
+}
+
+// leaves partial mode
+void lcd_set_normal_mode() {
+  lcd_send_cmd_byte(ILI9341_NORON);
+}
+
+// idle mode: only the MSB of each color channel is shown (8 colors)
+void lcd_set_idle(bool idle) {
+  lcd_send_cmd_byte(idle ? ILI9341_IDMON : ILI9341_IDMOFF);
+}
+
 void lcd_set_addr(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
  
+  uint16_t list_buf[LCD_SET_ADDR_LIST_SIZE];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, LCD_SET_ADDR_LIST_SIZE);
+
   uint8_t coordinates[8] = {
     (uint8_t) (x1 >> 8),
     (uint8_t) (x1 & 0xff),
@@ -46,26 +124,18 @@ void lcd_set_addr(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
     (uint8_t) (y2 & 0xff)
   };
   
-  lcd_send_cmd_byte(ILI9341_CASET); // column address set
+  lcd_cmdlist_cmd(&list, ILI9341_CASET); // column address set
   for (int i = 0; i < 4; i++)
-    lcd_send_dat_byte(coordinates[i]);
+    lcd_cmdlist_dat(&list, coordinates[i]);
 
     
-  lcd_send_cmd_byte(ILI9341_PASET);  // page address set
+  lcd_cmdlist_cmd(&list, ILI9341_PASET);  // page address set
   for (int i = 0; i < 4; i++)
-    lcd_send_dat_byte(coordinates[i + 4]);
-
-  lcd_send_cmd_byte(ILI9341_RAMWR); //memory write 
-
-  // WA for a PIO program bug that causes the state transistion
-  // being too ealry before the pins have been written (?)
-  #if !defined LCD_DOUBLE_PIXEL_NEAREST
-    for (int i = 0; i < 2; i++)
-      lcd_send_dat_byte(0x00);
-  #else
-    for (int i = 0; i < 4; i++)
-      lcd_send_dat_byte(0x00);
-  #endif
+    lcd_cmdlist_dat(&list, coordinates[i + 4]);
+
+  lcd_cmdlist_cmd(&list, ILI9341_RAMWR); //memory write 
+
+  lcd_cmdlist_send(&list);
 }
 
 void lcd_controller_init() {
@@ -79,147 +149,153 @@ void lcd_controller_init() {
 
   delay(50);
 
-  lcd_send_cmd_byte(0xEF);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0x80);
-  lcd_send_dat_byte(0x02);
-
-  lcd_send_cmd_byte(0xCF);
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0XC1);
-  lcd_send_dat_byte(0X30);
-
-  lcd_send_cmd_byte(0xED);
-  lcd_send_dat_byte(0x64);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0X12);
-  lcd_send_dat_byte(0X81);
-
-  lcd_send_cmd_byte(0xE8);
-  lcd_send_dat_byte(0x85);
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x78);
-
-  lcd_send_cmd_byte(0xCB);
-  lcd_send_dat_byte(0x39);
-  lcd_send_dat_byte(0x2C);
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x34);
-  lcd_send_dat_byte(0x02);
-
-  lcd_send_cmd_byte(0xF7);
-  lcd_send_dat_byte(0x20);
-
-  lcd_send_cmd_byte(0xEA);
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x00);
+  lcd_cmdlist_t list;
+  uint16_t list_buf[LCD_INIT_LIST_SIZE];
+
+  lcd_cmdlist_init(&list, list_buf, LCD_INIT_LIST_SIZE);
+
+  lcd_cmdlist_cmd(&list, 0xEF);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0x80);
+  lcd_cmdlist_dat(&list, 0x02);
+
+  lcd_cmdlist_cmd(&list, 0xCF);
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0XC1);
+  lcd_cmdlist_dat(&list, 0X30);
+
+  lcd_cmdlist_cmd(&list, 0xED);
+  lcd_cmdlist_dat(&list, 0x64);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0X12);
+  lcd_cmdlist_dat(&list, 0X81);
+
+  lcd_cmdlist_cmd(&list, 0xE8);
+  lcd_cmdlist_dat(&list, 0x85);
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x78);
+
+  lcd_cmdlist_cmd(&list, 0xCB);
+  lcd_cmdlist_dat(&list, 0x39);
+  lcd_cmdlist_dat(&list, 0x2C);
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x34);
+  lcd_cmdlist_dat(&list, 0x02);
+
+  lcd_cmdlist_cmd(&list, 0xF7);
+  lcd_cmdlist_dat(&list, 0x20);
+
+  lcd_cmdlist_cmd(&list, 0xEA);
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x00);
 
 /*
-  lcd_send_cmd_byte(ILI9341_PWCTR1);    //Power control
-  lcd_send_dat_byte(0x23);   //VRH[5:0]
+  lcd_cmdlist_cmd(&list, ILI9341_PWCTR1);    //Power control
+  lcd_cmdlist_dat(&list, 0x23);   //VRH[5:0]
 
-  lcd_send_cmd_byte(ILI9341_PWCTR2);    //Power control
-  lcd_send_dat_byte(0x10);   //SAP[2:0];BT[3:0]
+  lcd_cmdlist_cmd(&list, ILI9341_PWCTR2);    //Power control
+  lcd_cmdlist_dat(&list, 0x10);   //SAP[2:0];BT[3:0]
 
-  lcd_send_cmd_byte(ILI9341_VMCTR1);    //VCM control
-  lcd_send_dat_byte(0x3e);
-  lcd_send_dat_byte(0x28);
+  lcd_cmdlist_cmd(&list, ILI9341_VMCTR1);    //VCM control
+  lcd_cmdlist_dat(&list, 0x3e);
+  lcd_cmdlist_dat(&list, 0x28);
 */
 
-  lcd_send_cmd_byte(ILI9341_PWCTR1);    //Power control
-  lcd_send_dat_byte(0x0b);   // 3.4V reference
+  lcd_cmdlist_cmd(&list, ILI9341_PWCTR1);    //Power control
+  lcd_cmdlist_dat(&list, 0x0b);   // 3.4V reference
   
-  lcd_send_cmd_byte(ILI9341_PWCTR2);    //Power control
-  lcd_send_dat_byte(0x10);   //SAP[2:0];BT[3:0]
+  lcd_cmdlist_cmd(&list, ILI9341_PWCTR2);    //Power control
+  lcd_cmdlist_dat(&list, 0x10);   //SAP[2:0];BT[3:0]
 
-  lcd_send_cmd_byte(ILI9341_VMCTR1);    //VCM control
-  lcd_send_dat_byte(0x1c);  // 3.4V VCOMH
-  lcd_send_dat_byte(0x28);  // -0.5V VCOML
+  lcd_cmdlist_cmd(&list, ILI9341_VMCTR1);    //VCM control
+  lcd_cmdlist_dat(&list, 0x1c);  // 3.4V VCOMH
+  lcd_cmdlist_dat(&list, 0x28);  // -0.5V VCOML
   
-  lcd_send_cmd_byte(ILI9341_VMCTR2);    //VCM control2
-  lcd_send_dat_byte(0x86);  //--
-
-  lcd_send_cmd_byte(ILI9341_PIXFMT);
-  lcd_send_dat_byte(0x55);
-
-  lcd_send_cmd_byte(ILI9341_FRMCTR1);
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x13); // 0x18 79Hz, 0x1B default 70Hz, 0x13 100Hz
-
-  lcd_send_cmd_byte(ILI9341_DFUNCTR);    // Display Function Control
-  lcd_send_dat_byte(0x08);
-  lcd_send_dat_byte(0x82);
-  lcd_send_dat_byte(0x27);
-
-  lcd_send_cmd_byte(0xF2);    // 3Gamma Function Disable
-  lcd_send_dat_byte(0x00);
-
-  lcd_send_cmd_byte(ILI9341_GAMMASET);    //Gamma curve selected
-  lcd_send_dat_byte(0x01);
-
-  lcd_send_cmd_byte(ILI9341_GMCTRP1);    //Set Gamma
-  lcd_send_dat_byte(0x0F);
-  lcd_send_dat_byte(0x31);
-  lcd_send_dat_byte(0x2B);
-  lcd_send_dat_byte(0x0C);
-  lcd_send_dat_byte(0x0E);
-  lcd_send_dat_byte(0x08);
-  lcd_send_dat_byte(0x4E);
-  lcd_send_dat_byte(0xF1);
-  lcd_send_dat_byte(0x37);
-  lcd_send_dat_byte(0x07);
-  lcd_send_dat_byte(0x10);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0x0E);
-  lcd_send_dat_byte(0x09);
-  lcd_send_dat_byte(0x00);
-
-  lcd_send_cmd_byte(ILI9341_GMCTRN1);    //Set Gamma
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x0E);
-  lcd_send_dat_byte(0x14);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0x11);
-  lcd_send_dat_byte(0x07);
-  lcd_send_dat_byte(0x31);
-  lcd_send_dat_byte(0xC1);
-  lcd_send_dat_byte(0x48);
-  lcd_send_dat_byte(0x08);
-  lcd_send_dat_byte(0x0F);
-  lcd_send_dat_byte(0x0C);
-  lcd_send_dat_byte(0x31);
-  lcd_send_dat_byte(0x36);
-  lcd_send_dat_byte(0x0F);
-
-  lcd_send_cmd_byte(ILI9341_SLPOUT);    //Exit Sleep
- 
+  lcd_cmdlist_cmd(&list, ILI9341_VMCTR2);    //VCM control2
+  lcd_cmdlist_dat(&list, 0x86);  //--
+
+  lcd_cmdlist_cmd(&list, ILI9341_PIXFMT);
+  lcd_cmdlist_dat(&list, 0x55);
+
+  lcd_cmdlist_cmd(&list, ILI9341_FRMCTR1);
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x13); // 0x18 79Hz, 0x1B default 70Hz, 0x13 100Hz
+
+  lcd_cmdlist_cmd(&list, ILI9341_DFUNCTR);    // Display Function Control
+  lcd_cmdlist_dat(&list, 0x08);
+  lcd_cmdlist_dat(&list, 0x82);
+  lcd_cmdlist_dat(&list, 0x27);
+
+  lcd_cmdlist_cmd(&list, 0xF2);    // 3Gamma Function Disable
+  lcd_cmdlist_dat(&list, 0x00);
+
+  lcd_cmdlist_cmd(&list, ILI9341_GAMMASET);    //Gamma curve selected
+  lcd_cmdlist_dat(&list, 0x01);
+
+  lcd_cmdlist_cmd(&list, ILI9341_GMCTRP1);    //Set Gamma
+  lcd_cmdlist_dat(&list, 0x0F);
+  lcd_cmdlist_dat(&list, 0x31);
+  lcd_cmdlist_dat(&list, 0x2B);
+  lcd_cmdlist_dat(&list, 0x0C);
+  lcd_cmdlist_dat(&list, 0x0E);
+  lcd_cmdlist_dat(&list, 0x08);
+  lcd_cmdlist_dat(&list, 0x4E);
+  lcd_cmdlist_dat(&list, 0xF1);
+  lcd_cmdlist_dat(&list, 0x37);
+  lcd_cmdlist_dat(&list, 0x07);
+  lcd_cmdlist_dat(&list, 0x10);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0x0E);
+  lcd_cmdlist_dat(&list, 0x09);
+  lcd_cmdlist_dat(&list, 0x00);
+
+  lcd_cmdlist_cmd(&list, ILI9341_GMCTRN1);    //Set Gamma
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x0E);
+  lcd_cmdlist_dat(&list, 0x14);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0x11);
+  lcd_cmdlist_dat(&list, 0x07);
+  lcd_cmdlist_dat(&list, 0x31);
+  lcd_cmdlist_dat(&list, 0xC1);
+  lcd_cmdlist_dat(&list, 0x48);
+  lcd_cmdlist_dat(&list, 0x08);
+  lcd_cmdlist_dat(&list, 0x0F);
+  lcd_cmdlist_dat(&list, 0x0C);
+  lcd_cmdlist_dat(&list, 0x31);
+  lcd_cmdlist_dat(&list, 0x36);
+  lcd_cmdlist_dat(&list, 0x0F);
+
+  lcd_cmdlist_cmd(&list, ILI9341_SLPOUT);    //Exit Sleep
+
+  lcd_cmdlist_send(&list);
+
   set_rs(LOW);
   delay(120);
   set_rs(HIGH);
   
   lcd_enable_te();
   
-  lcd_send_cmd_byte(ILI9341_DISPON);    //Display on
+  lcd_cmdlist_init(&list, list_buf, LCD_INIT_LIST_SIZE);
 
-  lcd_send_cmd_byte(ILI9341_MADCTL);    // Memory Access Control
+  lcd_cmdlist_cmd(&list, ILI9341_DISPON);    //Display on
+
+  lcd_cmdlist_cmd(&list, ILI9341_MADCTL);    // Memory Access Control
   
   #if LCD_ROTATION==0
-    lcd_send_dat_byte(ILI9341_MAD_MX | ILI9341_MAD_COLOR_ORDER); // Rotation 0 (portrait mode)
- 	lcd_set_addr(0, 0, PHYS_SCREEN_WIDTH - 1, PHYS_SCREEN_HEIGHT - 1);
+    lcd_cmdlist_dat(&list, ILI9341_MAD_MX | ILI9341_MAD_COLOR_ORDER); // Rotation 0 (portrait mode)
   #elif LCD_ROTATION==1
-    lcd_send_dat_byte(ILI9341_MAD_MV | ILI9341_MAD_MX | ILI9341_MAD_MY | ILI9341_MAD_COLOR_ORDER); // Rotation 90 (landscape mode)
-	lcd_set_addr(0, 0, PHYS_SCREEN_HEIGHT - 1, PHYS_SCREEN_WIDTH - 1);
+    lcd_cmdlist_dat(&list, ILI9341_MAD_MV | ILI9341_MAD_MX | ILI9341_MAD_MY | ILI9341_MAD_COLOR_ORDER); // Rotation 90 (landscape mode)
   #elif LCD_ROTATION==2
-    lcd_send_dat_byte(ILI9341_MAD_MY | ILI9341_MAD_COLOR_ORDER); // Rotation 180 (portrait mode)
- 	lcd_set_addr(0, 0, PHYS_SCREEN_WIDTH - 1, PHYS_SCREEN_HEIGHT - 1);
+    lcd_cmdlist_dat(&list, ILI9341_MAD_MY | ILI9341_MAD_COLOR_ORDER); // Rotation 180 (portrait mode)
   #elif LCD_ROTATION==3
-    lcd_send_dat_byte(ILI9341_MAD_MV | ILI9341_MAD_COLOR_ORDER); // Rotation 270 (landscape mode)
-	lcd_set_addr(0, 0, PHYS_SCREEN_HEIGHT - 1, PHYS_SCREEN_WIDTH - 1);
+    lcd_cmdlist_dat(&list, ILI9341_MAD_MV | ILI9341_MAD_COLOR_ORDER); // Rotation 270 (landscape mode)
   #endif
 
+  lcd_cmdlist_send(&list);
+
   // clear screen to black
-  for (uint32_t jj = 0; jj < PHYS_SCREEN_WIDTH * PHYS_SCREEN_HEIGHT * 2; jj++)
-    lcd_send_dat_byte(0x00);
+  lcd_fill_screen(0x0000);
 
 }
 
@@ -105,6 +105,8 @@
 #define ILI9341_TEON    0x35
 #define ILI9341_MADCTL  0x36
 #define ILI9341_VSCRSADD 0x37
+#define ILI9341_IDMOFF  0x38
+#define ILI9341_IDMON   0x39
 #define ILI9341_PIXFMT  0x3A
 
 #define ILI9341_WRDISBV  0x51
@@ -12,6 +12,11 @@
 
 #include <Arduino.h>
 #include "ili9488_drv.h"
+#include "../lcd_if/lcdcom.h"
+
+#ifdef LCD_BUS_RGB444
+#error The ILI9488 does not support the 12 bit (RGB444) bus format
+#endif
 
 /* ==================== forward declarations ==================== */
 void lcd_send_dat_byte(uint8_t cmd);
@@ -19,23 +24,95 @@ void lcd_send_cmd_byte(uint8_t cmd);
 void set_rs(byte value);
 void set_rst(byte value);
 
+/* ==================== definitions ==================== */
+// CASET, PASET and RAMWR (with parameters)
+#define LCD_SET_ADDR_LIST_SIZE 11
+
+// max. number of entries sent at once during the controller setup
+#define LCD_INIT_LIST_SIZE 128
+
 /* ==================== functions ==================== */
 void lcd_enable_te() {
-  //  lcdSendCmdByte(ILI9341_TEON);
-  //  lcdSendDatByte(0x00); // V-blank info only
+  lcd_send_cmd_byte(ILI9488_TEON);
+  lcd_send_dat_byte(0x00); // V-blank info only
 }
 
 void lcd_disable_te() {
-  //  lcd_send_cmd_byte(ILI9341_TEOFF);
+  lcd_send_cmd_byte(ILI9488_TEOFF);
 }
 
 bool lcd_get_vblank() {
-  //return digitalRead(LCD_PIN_TE);
-  return false;
+  return digitalRead(PIN_LCD_TE);
+}
+
+// fixed top area, scrolling area and fixed bottom area (in lines of the
+// controller, the sum must equal its number of lines)
+void lcd_set_scroll_area(uint16_t top, uint16_t height, uint16_t bottom) {
+  uint16_t list_buf[8];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 8);
+
+  lcd_cmdlist_cmd(&list, ILI9488_VSCRDEF);
+  lcd_cmdlist_dat(&list, top >> 8);
+  lcd_cmdlist_dat(&list, top & 0xff);
+  lcd_cmdlist_dat(&list, height >> 8);
+  lcd_cmdlist_dat(&list, height & 0xff);
+  lcd_cmdlist_dat(&list, bottom >> 8);
+  lcd_cmdlist_dat(&list, bottom & 0xff);
+
+  lcd_cmdlist_send(&list);
+}
+
+// line of the controller's memory shown at the top of the scrolling area
+void lcd_set_scroll_start(uint16_t line) {
+  uint16_t list_buf[4];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 4);
+
+  lcd_cmdlist_cmd(&list, ILI9488_VSCRSADD);
+  lcd_cmdlist_dat(&list, line >> 8);
+  lcd_cmdlist_dat(&list, line & 0xff);
+
+  lcd_cmdlist_send(&list);
+}
+
+// lines of the controller shown in partial mode (the others are blanked),
+// enters partial mode
+void lcd_set_partial_area(uint16_t first, uint16_t last) {
+  uint16_t list_buf[6];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, 6);
+
+  lcd_cmdlist_cmd(&list, ILI9488_PTLAR);
+  lcd_cmdlist_dat(&list, first >> 8);
+  lcd_cmdlist_dat(&list, first & 0xff);
+  lcd_cmdlist_dat(&list, last >> 8);
+  lcd_cmdlist_dat(&list, last & 0xff);
+  lcd_cmdlist_cmd(&list, ILI9488_PTLON);
+
+  lcd_cmdlist_send(&list);
+}
+
+// leaves partial mode
+void lcd_set_normal_mode() {
+  lcd_send_cmd_byte(ILI9488_NORON);
+}
+
+// idle mode: only the MSB of each color channel is shown (8 colors)
+void lcd_set_idle(bool idle) {
+  lcd_send_cmd_byte(idle ? ILI9488_IDMON : ILI9488_IDMOFF);
 }
 
 void lcd_set_addr(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
 
+  uint16_t list_buf[LCD_SET_ADDR_LIST_SIZE];
+  lcd_cmdlist_t list;
+
+  lcd_cmdlist_init(&list, list_buf, LCD_SET_ADDR_LIST_SIZE);
+
   uint8_t coordinates[8] = {
     (uint8_t)(x1 >> 8),
     (uint8_t)(x1 & 0xff),
@@ -47,25 +124,17 @@ void lcd_set_addr(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
     (uint8_t)(y2 & 0xff)
   };
 
-  lcd_send_cmd_byte(ILI9488_CASET);  // column address set
+  lcd_cmdlist_cmd(&list, ILI9488_CASET);  // column address set
   for (int i = 0; i < 4; i++)
-    lcd_send_dat_byte(coordinates[i]);
+    lcd_cmdlist_dat(&list, coordinates[i]);
 
-  lcd_send_cmd_byte(ILI9488_PASET);  // page address set
+  lcd_cmdlist_cmd(&list, ILI9488_PASET);  // page address set
   for (int i = 0; i < 4; i++)
-    lcd_send_dat_byte(coordinates[i + 4]);
+    lcd_cmdlist_dat(&list, coordinates[i + 4]);
 
-  lcd_send_cmd_byte(ILI9488_RAMWR);  //memory write
+  lcd_cmdlist_cmd(&list, ILI9488_RAMWR);  //memory write
 
-  // WA for a PIO program bug that causes the state transistion
-  // being too ealry before the pins have been written (?)
-  #if !defined LCD_DOUBLE_PIXEL_NEAREST
-    for (int i = 0; i < 2; i++)
-      lcd_send_dat_byte(0x00);
-  #else
-    for (int i = 0; i < 4; i++)
-      lcd_send_dat_byte(0x00);
-  #endif
+  lcd_cmdlist_send(&list);
 }
 
 void lcd_controller_init() {
@@ -84,82 +153,88 @@ void lcd_controller_init() {
 
   // Configure ILI9488 display
 
-  lcd_send_cmd_byte(0xE0);  // Positive Gamma Control
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0x09);
-  lcd_send_dat_byte(0x08);
-  lcd_send_dat_byte(0x16);
-  lcd_send_dat_byte(0x0A);
-  lcd_send_dat_byte(0x3F);
-  lcd_send_dat_byte(0x78);
-  lcd_send_dat_byte(0x4C);
-  lcd_send_dat_byte(0x09);
-  lcd_send_dat_byte(0x0A);
-  lcd_send_dat_byte(0x08);
-  lcd_send_dat_byte(0x16);
-  lcd_send_dat_byte(0x1A);
-  lcd_send_dat_byte(0x0F);
-
-  lcd_send_cmd_byte(0XE1);  // Negative Gamma Control
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x16);
-  lcd_send_dat_byte(0x19);
-  lcd_send_dat_byte(0x03);
-  lcd_send_dat_byte(0x0F);
-  lcd_send_dat_byte(0x05);
-  lcd_send_dat_byte(0x32);
-  lcd_send_dat_byte(0x45);
-  lcd_send_dat_byte(0x46);
-  lcd_send_dat_byte(0x04);
-  lcd_send_dat_byte(0x0E);
-  lcd_send_dat_byte(0x0D);
-  lcd_send_dat_byte(0x35);
-  lcd_send_dat_byte(0x37);
-  lcd_send_dat_byte(0x0F);
-
-  lcd_send_cmd_byte(0XC0);  // Power Control 1
-  lcd_send_dat_byte(0x17);
-  lcd_send_dat_byte(0x15);
-
-  lcd_send_cmd_byte(0xC1);  // Power Control 2
-  lcd_send_dat_byte(0x41);
-
-  lcd_send_cmd_byte(0xC5);  // VCOM Control
-  lcd_send_dat_byte(0x00);
-  lcd_send_dat_byte(0x12);
-  lcd_send_dat_byte(0x80);
-
-  lcd_send_cmd_byte(ILI9488_MADCTL);  // Memory Access Control
-  lcd_send_dat_byte(0x48);            // MX, BGR
-
-  lcd_send_cmd_byte(0x3A);  // Pixel Interface Format
-  lcd_send_dat_byte(0x55);  // 16 bit colour for parallel
-
-  lcd_send_cmd_byte(0xB0);  // Interface Mode Control
-  lcd_send_dat_byte(0x00);
-
-  lcd_send_cmd_byte(0xB1);  // Frame Rate Control
-  lcd_send_dat_byte(0xA0);
-
-  lcd_send_cmd_byte(0xB4);  // Display Inversion Control
-  lcd_send_dat_byte(0x02);
-
-  lcd_send_cmd_byte(0xB6);  // Display Function Control
-  lcd_send_dat_byte(0x02);
-  lcd_send_dat_byte(0x02);
-  lcd_send_dat_byte(0x3B);
-
-  lcd_send_cmd_byte(0xB7);  // Entry Mode Set
-  lcd_send_dat_byte(0xC6);
-
-  lcd_send_cmd_byte(0xF7);  // Adjust Control 3
-  lcd_send_dat_byte(0xA9);
-  lcd_send_dat_byte(0x51);
-  lcd_send_dat_byte(0x2C);
-  lcd_send_dat_byte(0x82);
-
-  lcd_send_cmd_byte(ILI9488_SLPOUT);  //Exit Sleep
+  lcd_cmdlist_t list;
+  uint16_t list_buf[LCD_INIT_LIST_SIZE];
+
+  lcd_cmdlist_init(&list, list_buf, LCD_INIT_LIST_SIZE);
+
+  lcd_cmdlist_cmd(&list, 0xE0);  // Positive Gamma Control
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0x09);
+  lcd_cmdlist_dat(&list, 0x08);
+  lcd_cmdlist_dat(&list, 0x16);
+  lcd_cmdlist_dat(&list, 0x0A);
+  lcd_cmdlist_dat(&list, 0x3F);
+  lcd_cmdlist_dat(&list, 0x78);
+  lcd_cmdlist_dat(&list, 0x4C);
+  lcd_cmdlist_dat(&list, 0x09);
+  lcd_cmdlist_dat(&list, 0x0A);
+  lcd_cmdlist_dat(&list, 0x08);
+  lcd_cmdlist_dat(&list, 0x16);
+  lcd_cmdlist_dat(&list, 0x1A);
+  lcd_cmdlist_dat(&list, 0x0F);
+
+  lcd_cmdlist_cmd(&list, 0XE1);  // Negative Gamma Control
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x16);
+  lcd_cmdlist_dat(&list, 0x19);
+  lcd_cmdlist_dat(&list, 0x03);
+  lcd_cmdlist_dat(&list, 0x0F);
+  lcd_cmdlist_dat(&list, 0x05);
+  lcd_cmdlist_dat(&list, 0x32);
+  lcd_cmdlist_dat(&list, 0x45);
+  lcd_cmdlist_dat(&list, 0x46);
+  lcd_cmdlist_dat(&list, 0x04);
+  lcd_cmdlist_dat(&list, 0x0E);
+  lcd_cmdlist_dat(&list, 0x0D);
+  lcd_cmdlist_dat(&list, 0x35);
+  lcd_cmdlist_dat(&list, 0x37);
+  lcd_cmdlist_dat(&list, 0x0F);
+
+  lcd_cmdlist_cmd(&list, 0XC0);  // Power Control 1
+  lcd_cmdlist_dat(&list, 0x17);
+  lcd_cmdlist_dat(&list, 0x15);
+
+  lcd_cmdlist_cmd(&list, 0xC1);  // Power Control 2
+  lcd_cmdlist_dat(&list, 0x41);
+
+  lcd_cmdlist_cmd(&list, 0xC5);  // VCOM Control
+  lcd_cmdlist_dat(&list, 0x00);
+  lcd_cmdlist_dat(&list, 0x12);
+  lcd_cmdlist_dat(&list, 0x80);
+
+  lcd_cmdlist_cmd(&list, ILI9488_MADCTL);  // Memory Access Control
+  lcd_cmdlist_dat(&list, 0x48);            // MX, BGR
+
+  lcd_cmdlist_cmd(&list, 0x3A);  // Pixel Interface Format
+  lcd_cmdlist_dat(&list, 0x55);  // 16 bit colour for parallel
+
+  lcd_cmdlist_cmd(&list, 0xB0);  // Interface Mode Control
+  lcd_cmdlist_dat(&list, 0x00);
+
+  lcd_cmdlist_cmd(&list, 0xB1);  // Frame Rate Control
+  lcd_cmdlist_dat(&list, 0xA0);
+
+  lcd_cmdlist_cmd(&list, 0xB4);  // Display Inversion Control
+  lcd_cmdlist_dat(&list, 0x02);
+
+  lcd_cmdlist_cmd(&list, 0xB6);  // Display Function Control
+  lcd_cmdlist_dat(&list, 0x02);
+  lcd_cmdlist_dat(&list, 0x02);
+  lcd_cmdlist_dat(&list, 0x3B);
+
+  lcd_cmdlist_cmd(&list, 0xB7);  // Entry Mode Set
+  lcd_cmdlist_dat(&list, 0xC6);
+
+  lcd_cmdlist_cmd(&list, 0xF7);  // Adjust Control 3
+  lcd_cmdlist_dat(&list, 0xA9);
+  lcd_cmdlist_dat(&list, 0x51);
+  lcd_cmdlist_dat(&list, 0x2C);
+  lcd_cmdlist_dat(&list, 0x82);
+
+  lcd_cmdlist_cmd(&list, ILI9488_SLPOUT);  //Exit Sleep
+  lcd_cmdlist_send(&list);
   delay(120);
 
   lcd_send_cmd_byte(ILI9488_DISPON);  //Display on
@@ -171,8 +246,7 @@ void lcd_controller_init() {
   lcd_send_dat_byte(0x0);
 
   lcd_send_cmd_byte(ILI9488_RAMWR);  // Write GRAM
-  for (uint32_t jj = 0; jj < 320 * 480 * 2; jj++)
-    lcd_send_dat_byte(random(256));
+  lcd_send_fill(0x0000, 320 * 480);
 
   lcd_send_cmd_byte(ILI9488_MADCTL);  // Memory Access Control
 
@@ -15,8 +15,7 @@
 
 /* ======================== defines ============================= */
 /* ---------------------- screen dimensions ----------------------*/
-// physical values
-//#define ILI9488_CROPPED
+// physical values (ILI9488_CROPPED: see setup.h)
 #ifdef ILI9488_CROPPED
 #define PHYS_SCREEN_WIDTH   240 //320
 #define PHYS_SCREEN_HEIGHT  320 //480
@@ -53,6 +52,8 @@
 
 #define ILI9488_SLPIN   0x10
 #define ILI9488_SLPOUT  0x11
+#define ILI9488_PTLON   0x12
+#define ILI9488_NORON   0x13
 
 #define ILI9488_INVOFF  0x20
 #define ILI9488_INVON   0x21
@@ -66,7 +67,14 @@
 
 #define ILI9488_RAMRD   0x2E
 
+#define ILI9488_PTLAR   0x30
+#define ILI9488_VSCRDEF 0x33
+#define ILI9488_TEOFF   0x34
+#define ILI9488_TEON    0x35
 #define ILI9488_MADCTL  0x36
+#define ILI9488_VSCRSADD 0x37
+#define ILI9488_IDMOFF  0x38
+#define ILI9488_IDMON   0x39
 
 #define ILI9488_MAD_MY  0x80
 #define ILI9488_MAD_MX  0x40
@@ -63,8 +63,14 @@
 #define ST7789_RAMRD 0x2E
 
 #define ST7789_PTLAR 0x30
+#define ST7789_VSCRDEF 0x33
+#define ST7789_TEOFF 0x34
+#define ST7789_TEON 0x35
 #define ST7789_COLMOD 0x3A
 #define ST7789_MADCTL 0x36
+#define ST7789_VSCRSADD 0x37
+#define ST7789_IDMOFF 0x38
+#define ST7789_IDMON 0x39
 
 #define ST7789_MADCTL_MY 0x80
 #define ST7789_MADCTL_MX 0x40
@@ -26,71 +26,145 @@
 
 #include "hardware/pio.h"
 
-#if !defined LCD_DOUBLE_PIXEL_NEAREST
-
-	#define lcd_output_wrap_target 0
-	#define lcd_output_wrap 3
-
-	#define lcd_output_offset_tx_dat 0u
-	#define lcd_output_offset_tx_cmd 2u
-
-	static const uint16_t lcd_output_program_instructions[] = {
-				//     .wrap_target
-		0x7008, //  0: out    pins, 8         side 0     
-		0x1800, //  1: jmp    0               side 1     
-		0x7000, //  2: out    pins, 32        side 0     
-		0x7878, //  3: out    null, 24        side 1     
-				//     .wrap
-	};
-
-	static const struct pio_program lcd_output_program = {
-		.instructions = lcd_output_program_instructions,
-		.length = 4,
-		.origin = -1,
-	};
-
-	static inline pio_sm_config lcd_output_program_get_default_config(uint offset) {
-		pio_sm_config c = pio_get_default_sm_config();
-		sm_config_set_wrap(&c, offset + lcd_output_wrap_target, offset + lcd_output_wrap);
-		sm_config_set_sideset(&c, 2, true, false);
-		return c;
-	}
-
-#else
-
-	#define lcd_output_wrap_target 0
-	#define lcd_output_wrap 10
-
-	#define lcd_output_offset_tx_dat 0u
-	#define lcd_output_offset_tx_cmd 9u
-
-	static const uint16_t lcd_output_program_instructions[] = {
-				//     .wrap_target
-		0x7028, //  0: out    x, 8            side 0     
-		0xa001, //  1: mov    pins, x                    
-		0x7848, //  2: out    y, 8            side 1     
-		0xb002, //  3: mov    pins, y         side 0     
-		0xb842, //  4: nop                    side 1     
-		0xb001, //  5: mov    pins, x         side 0     
-		0xb842, //  6: nop                    side 1     
-		0xb002, //  7: mov    pins, y         side 0     
-		0x1800, //  8: jmp    0               side 1     
-		0x7000, //  9: out    pins, 32        side 0     
-		0x7878, // 10: out    null, 24        side 1     
-				//     .wrap
-	};
-
-	static const struct pio_program lcd_output_program = {
-		.instructions = lcd_output_program_instructions,
-		.length = 11,
-		.origin = -1,
-	};
-
-	static inline pio_sm_config lcd_output_program_get_default_config(uint offset) {
-		pio_sm_config c = pio_get_default_sm_config();
-		sm_config_set_wrap(&c, offset + lcd_output_wrap_target, offset + lcd_output_wrap);
-		sm_config_set_sideset(&c, 2, true, false);
-		return c;
-	}
-
-#endif
+// ------------------------------------------------ //
+// lcd_output (plain)                               //
+// ------------------------------------------------ //
+
+#define lcd_output_wrap_target 0
+#define lcd_output_wrap 3
+
+#define lcd_output_offset_tx_dat 0u
+#define lcd_output_offset_tx_cmd 2u
+
+static const uint16_t lcd_output_program_instructions[] = {
+			//     .wrap_target
+	0x7008, //  0: out    pins, 8         side 0     
+	0x1800, //  1: jmp    0               side 1     
+	0x7000, //  2: out    pins, 32        side 0     
+	0x7878, //  3: out    null, 24        side 1     
+			//     .wrap
+};
+
+static const struct pio_program lcd_output_program = {
+	.instructions = lcd_output_program_instructions,
+	.length = 4,
+	.origin = -1,
+};
+
+static inline pio_sm_config lcd_output_program_get_default_config(uint offset) {
+	pio_sm_config c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, offset + lcd_output_wrap_target, offset + lcd_output_wrap);
+	sm_config_set_sideset(&c, 2, true, false);
+	return c;
+}
+
+// ------------------------------------------------ //
+// lcd_output_ds (doublescan)                       //
+// ------------------------------------------------ //
+
+#define lcd_output_ds_wrap_target 0
+#define lcd_output_ds_wrap 10
+
+#define lcd_output_ds_offset_tx_dat 0u
+#define lcd_output_ds_offset_tx_cmd 9u
+
+static const uint16_t lcd_output_ds_program_instructions[] = {
+			//     .wrap_target
+	0x7028, //  0: out    x, 8            side 0     
+	0xa001, //  1: mov    pins, x                    
+	0x7848, //  2: out    y, 8            side 1     
+	0xb002, //  3: mov    pins, y         side 0     
+	0xb842, //  4: nop                    side 1     
+	0xb001, //  5: mov    pins, x         side 0     
+	0xb842, //  6: nop                    side 1     
+	0xb002, //  7: mov    pins, y         side 0     
+	0x1800, //  8: jmp    0               side 1     
+	0x7000, //  9: out    pins, 32        side 0     
+	0x7878, // 10: out    null, 24        side 1     
+			//     .wrap
+};
+
+static const struct pio_program lcd_output_ds_program = {
+	.instructions = lcd_output_ds_program_instructions,
+	.length = 11,
+	.origin = -1,
+};
+
+static inline pio_sm_config lcd_output_ds_program_get_default_config(uint offset) {
+	pio_sm_config c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, offset + lcd_output_ds_wrap_target, offset + lcd_output_ds_wrap);
+	sm_config_set_sideset(&c, 2, true, false);
+	return c;
+}
+
+// ------------------------------------------------ //
+// lcd_cmdlist (command lists)                      //
+// ------------------------------------------------ //
+
+#define lcd_cmdlist_wrap_target 0
+#define lcd_cmdlist_wrap 1
+
+static const uint16_t lcd_cmdlist_program_instructions[] = {
+			//     .wrap_target
+	0x6010, //  0: out    pins, 16                   
+	0xb842, //  1: nop                    side 1     
+			//     .wrap
+};
+
+static const struct pio_program lcd_cmdlist_program = {
+	.instructions = lcd_cmdlist_program_instructions,
+	.length = 2,
+	.origin = -1,
+};
+
+static inline pio_sm_config lcd_cmdlist_program_get_default_config(uint offset) {
+	pio_sm_config c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, offset + lcd_cmdlist_wrap_target, offset + lcd_cmdlist_wrap);
+	sm_config_set_sideset(&c, 2, true, false);
+	return c;
+}
+
+// ------------------------------------------------ //
+// lcd_output_444 (12 bit bus format)               //
+// ------------------------------------------------ //
+
+#define lcd_output_444_wrap_target 2
+#define lcd_output_444_wrap 16
+
+#define lcd_output_444_offset_tx_cmd 0u
+#define lcd_output_444_offset_tx_dat 2u
+
+static const uint16_t lcd_output_444_program_instructions[] = {
+	0x7000, //  0: out    pins, 32        side 0     
+	0x7878, //  1: out    null, 24        side 1     
+			//     .wrap_target
+	0x7824, //  2: out    x, 4            side 1     
+	0x4024, //  3: in     x, 4                       
+	0x6025, //  4: out    x, 5                       
+	0x4024, //  5: in     x, 4                       
+	0xb006, //  6: mov    pins, isr       side 0     
+	0x7826, //  7: out    x, 6            side 1     
+	0x4024, //  8: in     x, 4                       
+	0x6024, //  9: out    x, 4                       
+	0x4024, // 10: in     x, 4                       
+	0xb006, // 11: mov    pins, isr       side 0     
+	0x7825, // 12: out    x, 5            side 1     
+	0x4024, // 13: in     x, 4                       
+	0x6026, // 14: out    x, 6                       
+	0x4024, // 15: in     x, 4                       
+	0xb006, // 16: mov    pins, isr       side 0     
+			//     .wrap
+};
+
+static const struct pio_program lcd_output_444_program = {
+	.instructions = lcd_output_444_program_instructions,
+	.length = 17,
+	.origin = -1,
+};
+
+static inline pio_sm_config lcd_output_444_program_get_default_config(uint offset) {
+	pio_sm_config c = pio_get_default_sm_config();
+	sm_config_set_wrap(&c, offset + lcd_output_444_wrap_target, offset + lcd_output_444_wrap);
+	sm_config_set_sideset(&c, 2, true, false);
+	return c;
+}
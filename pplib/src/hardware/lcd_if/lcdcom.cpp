@@ -32,20 +32,73 @@
 #include "lcdcom.h"
 #include "../../graphics/gbuffers.h"
 #include "../../graphics/colors.h"
+#include "../../graphics/primitives.h"
 
 #include "hardware/dma.h"
 #include "hardware/pwm.h"
+#include "pico/multicore.h"
 
-#if LCD_COLORDEPTH == 8
 #include "lcd_pio_lut8.h"
-#endif
 #include "lcd_pio16.h"
 
-/* ==================== mutex ==================== */
-#if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-mutex_t lcd_scanout_complete;
+/* ======================== definitions ========================= */
+// initial screen mode (see setup.h)
+#if defined LCD_DOUBLE_PIXEL_NEAREST
+#define LCD_INIT_FITTER LCD_FITTER_NEAREST
+#elif defined LCD_DOUBLE_PIXEL_LINEAR
+#define LCD_INIT_FITTER LCD_FITTER_LINEAR
+#else
+#define LCD_INIT_FITTER LCD_FITTER_NONE
+#endif
+
+// physical screen size (taking the rotation into account)
+#if LCD_ROTATION==0 || LCD_ROTATION==2
+#define LCD_PHYS_WIDTH   PHYS_SCREEN_WIDTH
+#define LCD_PHYS_HEIGHT  PHYS_SCREEN_HEIGHT
+#elif LCD_ROTATION==1 || LCD_ROTATION==3
+#define LCD_PHYS_WIDTH   PHYS_SCREEN_HEIGHT
+#define LCD_PHYS_HEIGHT  PHYS_SCREEN_WIDTH
+#endif
+
+// number of interpolated lines buffered ahead of the DMA (linear fitter)
+#define LCD_LINE_BUFS 8
+
+// pixels of an 8 bit buffer converted at once by lcd_draw_buf (two slices
+// taken from the stack)
+#define LCD_DRAW_SLICE 128
+
+// Command list entries: the out pins of the command list program range from
+// DC to D7. The entries pull WR low (the reset pin in between is not driven
+// by the PIO), so WR stays high while the program waits for the next entry.
+#define LCD_CMDLIST_DAT_SHIFT (PIN_LCD_D0 - PIN_LCD_DC)
+#define LCD_CMDLIST_PINS      (PIN_LCD_D0 + 8 - PIN_LCD_DC)
+
+#if PIN_LCD_D0 < PIN_LCD_DC || LCD_CMDLIST_PINS > 16
+#error "Command lists need the DC pin to be located right below the data pins."
+#endif
+
+// The plain and the doublescan program send the low byte of each pixel
+// first, the RGB444 program reads the pixels MSB first.
+#ifdef LCD_BUS_RGB444
+#define LCD_DMA_BSWAP false
+#else
+#define LCD_DMA_BSWAP true
 #endif
 
+/* ==================== forward declarations ==================== */
+void lcd_pio_wait();
+void lcd_dma_wait();
+void lcd_wait_event();
+void lcd_reset_window();
+void lcd_set_window(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+void set_rs(byte value);
+void lcd_frame_done();
+void lcd_swap_detach();
+void lcd_band_next();
+void lcd_pal_select(const color_palette_t* pal);
+bool lcd_frame_crc(void* data, uint32_t* crc);
+lcd_error_t lcd_show_view(void* data, uint32_t stride, uint16_t buf_width, uint16_t buf_height, coord_t x, coord_t y);
+
 /* ========================= variables ========================== */
 /* ----------------------------- NN -----------------------------*/
 bool lcd_init_complete = false;
@@ -53,30 +106,115 @@ bool lcd_init_complete = false;
 /* ----------------------- backlight -----------------------------*/
 pwm_config lcd_bl_pwm_cfg = pwm_get_default_config();
 
+/* ---------------------- screen mode --------------------------*/
+uint8_t lcd_depth = 0;                       // 1, 2, 4 (packed), 8 or 16 bits per pixel
+lcd_fitter_t lcd_fitter = LCD_FITTER_NONE;
+uint16_t lcd_scr_width = 0;                  // framebuffer geometry
+uint16_t lcd_scr_height = 0;
+uint8_t lcd_scale = 1;                       // physical pixels per framebuffer pixel
+uint8_t lcd_sc_num = 3;                      // scale factor of the scaler (num / den)
+uint8_t lcd_sc_den = 2;
+
 /* ----------------------- scanout -----------------------------*/
-volatile uint16_t dma_scanline = 0;
-volatile uint8_t scanline_even = 0;
+// false if the controller's window has been changed by a partial update or
+// a command other than RAMWR has ended the memory write
+bool lcd_window_full = true;
 
-#if LCD_COLORDEPTH == 8
-volatile uint8_t* cur_scanout_buf = NULL;
-#elif LCD_COLORDEPTH == 16
-volatile uint16_t* cur_scanout_buf = NULL;
-#endif
+// set while a full frame is being sent (cleared by the ISR)
+volatile bool lcd_frame_active = false;
 
-#if LCD_COLORDEPTH == 8 && !defined LCD_DOUBLE_PIXEL_LINEAR && defined LCD_DOUBLE_PIXEL_NEAREST
-uint8_t scanline_buf[SCREEN_WIDTH * 2];
-#elif LCD_COLORDEPTH == 16 && defined LCD_DOUBLE_PIXEL_NEAREST
-uint16_t scanline_buf[SCREEN_WIDTH * 2];
-#elif defined LCD_DOUBLE_PIXEL_LINEAR
-uint16_t* scanline_buf_lst = (uint16_t*)malloc(SCREEN_WIDTH * 2 * 2);  // double resolution, 16 bpp
-uint16_t* scanline_buf_nxt = (uint16_t*)malloc(SCREEN_WIDTH * 2 * 2);
-uint16_t* scanline_buf_mid = (uint16_t*)malloc(SCREEN_WIDTH * 2 * 2);
-#endif
+// parity of the lines sent by the next interlaced field
+uint8_t lcd_field = 0;
+
+// checksums of the bands of lines last sent by lcd_show_changed (only valid
+// as long as nothing else has been sent)
+uint32_t lcd_crc[(LCD_PHYS_HEIGHT + LCD_CRC_BAND_HEIGHT - 1) / LCD_CRC_BAND_HEIGHT];
+bool lcd_crc_valid = false;
+
+// Static screens (partial display / idle mode): checksum of the last frame
+// presented (only valid as long as nothing else has been sent)
+bool lcd_static_active = false;
+uint32_t lcd_static_crc = 0;
+bool lcd_static_valid = false;
+
+// strip buffers owned by the strip renderer
+gbuffer_t lcd_strip_buf[2];
+bool lcd_strip_allocated = false;
+
+// swap chain whose buffers are being presented (NULL if none)
+lcd_swapchain_t* volatile lcd_swap_active = NULL;
+
+// called by the DMA ISR after the last transfer of every frame
+lcd_frame_cb_t lcd_frame_callback = NULL;
+
+// hardware scrolling: fixed top area and scrolling area (in lines of the
+// controller) and the current offset into the scrolling area
+uint16_t lcd_scroll_top = 0;
+uint16_t lcd_scroll_height = PHYS_SCREEN_HEIGHT;
+uint16_t lcd_scroll_ofs = 0;
+
+// NULL while a composed frame is being sent
+volatile void* cur_scanout_buf = NULL;
+
+// bands of the composed frame being sent
+lcd_comp_band_t lcd_comp_bands[LCD_COMP_MAX_BANDS];
+
+// distance of the lines of the frame being sent in bytes (larger than a
+// line of the screen when showing a viewport of a larger buffer)
+uint32_t lcd_scan_stride = 0;
+
+// size of the frame being sent (smaller than the screen when presented
+// into a window)
+uint16_t lcd_frm_width = 0;
+uint16_t lcd_frm_height = 0;
+
+// area around the window last presented to, filled with lcd_border_color
+bool lcd_border_valid = false;
+lcd_rect_t lcd_border_win;
+uint16_t lcd_border_color = 0x0000;
+
+// line pointers of the frame being sent (one per physical line), each band
+// of lines (see palette splits) NULL terminated
+void* lcd_row_table[LCD_PHYS_HEIGHT + LCD_PAL_MAX_SPLITS + 1];
+
+// first row table entry of each band
+uint16_t lcd_band_row[LCD_PAL_MAX_SPLITS + 1];
+
+// buffer (line distance and height) the row table has been built for
+void* lcd_row_table_buf = NULL;
+uint32_t lcd_row_table_stride = 0;
+uint16_t lcd_row_table_height = 0;
+
+// ring of interpolated or scaled physical lines (RGB565) filled by core1
+// plus one line of scratch space (linear fitter and scaler only)
+uint16_t* lcd_line_buf = NULL;
+
+// incremented by core0 for every frame to be interpolated by core1
+volatile uint32_t lcd_lin_frame = 0;
+
+// number of ring lines listed in the row table (the NULL entry follows)
+uint16_t lcd_lin_rows = 0;
 
 /* ----------------------------- PIO -----------------------------*/
 PIO lcd_pio = pio0;
-int8_t lcd_pio_tft_sm = 0;
-int8_t lcd_pio_lut_sm = 0;
+int8_t lcd_pio_tft_sm = -1;
+int8_t lcd_pio_lut_sm = -1;
+
+// state machine fed by DMA channel 0 (the LUT SM in 8 bit mode)
+int8_t lcd_pio_data_sm = -1;
+
+// program offsets (all programs stay loaded)
+uint32_t lcd_pio_ofs_plain = 0;
+uint32_t lcd_pio_ofs_ds = 0;
+uint32_t lcd_pio_ofs_lut = 0;
+uint32_t lcd_pio_ofs_cmdlist = 0;
+
+// the TFT SM runs the doublescan program
+bool lcd_pio_ds_active = false;
+
+// clock divider of the state machines
+uint16_t lcd_pio_clk_div = 10;
+uint8_t lcd_pio_clk_frac = 1;
 
 // SM stalled mask
 uint32_t pio_pull_stall_mask = 0;
@@ -85,30 +223,132 @@ uint32_t pio_pull_stall_mask = 0;
 uint32_t pio_instr_jmp8 = 0;
 
 /* ----------------------------- DMA -----------------------------*/
-#if LCD_COLORDEPTH==8
 #define LCD_NUM_DMA 3
-#elif LCD_COLORDEPTH==16
-#define LCD_NUM_DMA 1
-#endif
 
-int32_t lcd_dma_chan[LCD_NUM_DMA];
+// channel 0 is always claimed, 1 and 2 only in 8 bit mode
+int32_t lcd_dma_chan[LCD_NUM_DMA] = { -1, -1, -1 };
 dma_channel_config lcd_dma_config[LCD_NUM_DMA];
 
+// control channel and data channel configuration for row chains (claimed
+// while a panel fitter is active)
+int32_t lcd_dma_ctrl_chan = -1;
+dma_channel_config lcd_dma_ctrl_config;
+dma_channel_config lcd_dma_row_config;
+
 uint8_t lcd_dma_enabled = 0;
 
+// color sent by lcd_send_fill (read by the DMA)
+uint16_t lcd_fill_color;
+
+// channel computing the checksums of the bands (claimed on first use)
+int lcd_dma_crc_chan = -1;
+uint32_t lcd_dma_crc_dummy;
+
 /* -------------------- custom palette (LUT) ---------------------- */
-#if LCD_COLORDEPTH==8
-color_palette_t lcd_palette[256] __attribute__((aligned(512), section(".scratch_x.parity")));
-#endif
+// front and back palette
+color_palette_t lcd_palette[2][256] __attribute__((aligned(512), section(".scratch_x.parity")));
+uint8_t lcd_pal_front = 0;
+
+// the back palette becomes the front palette when the next frame starts
+volatile bool lcd_pal_flip_pending = false;
+
+// the back palette does not hold a copy of the front palette yet
+bool lcd_pal_back_stale = true;
+
+// palette the LUT SM is currently looking up
+const color_palette_t* lcd_pal_lut_base = NULL;
+
+// palette changes per frame (the second set is switched to when the next frame starts)
+lcd_pal_split_t lcd_pal_splits[2][LCD_PAL_MAX_SPLITS];
+uint8_t lcd_pal_num_splits[2] = { 0, 0 };
+uint8_t lcd_pal_splits_cur = 0;
+volatile bool lcd_pal_splits_pending = false;
+
+// palettes of the bands of a frame (prepared one band ahead)
+color_palette_t lcd_pal_band_buf[2][256] __attribute__((aligned(512)));
+
+// bands of the frame being sent (band n starts at the line of split n-1)
+volatile uint8_t lcd_band = 0;
+uint8_t lcd_num_bands = 1;
 
 /* ======================= implementation ======================== */
 
-#if LCD_COLORDEPTH==8
 color_palette_t* lcd_get_palette_ptr() {
-  return &lcd_palette[0];
+  return &lcd_palette[lcd_pal_front][0];
 }
 
+color_palette_t* lcd_get_back_palette_ptr() {
+  // the back palette is still waiting to be shown
+  while (lcd_pal_flip_pending)
+    lcd_wait_event();
+
+  // changes are made on top of the palette being shown
+  if (lcd_pal_back_stale) {
+    memcpy(lcd_palette[lcd_pal_front ^ 1], lcd_palette[lcd_pal_front], sizeof(lcd_palette[0]));
+    lcd_pal_back_stale = false;
+  }
+
+  return &lcd_palette[lcd_pal_front ^ 1][0];
+}  // lcd_get_back_palette_ptr
+
+void lcd_flip_palette() {
+  lcd_pal_flip_pending = true;
+}  // lcd_flip_palette
+
+lcd_error_t lcd_set_palette_splits(const lcd_pal_split_t* splits, uint8_t num_splits) {
+  if (lcd_depth > 8)
+    return LCD_NOT_SUPPORTED;
+
+  if (num_splits > LCD_PAL_MAX_SPLITS)
+    return LCD_INVALID_PARAM;
+
+  for (uint8_t h = 0; h < num_splits; h++) {
+    if (splits[h].line < 0 || splits[h].line >= lcd_scr_height ||
+        splits[h].first + splits[h].count > 256 || splits[h].colors == NULL)
+      return LCD_INVALID_PARAM;
+
+    // the bands must not be empty (except for the first)
+    if (h > 0 && splits[h].line <= splits[h - 1].line)
+      return LCD_INVALID_PARAM;
+  }
+
+  // The ISR does not touch the second set while no switch is pending, so it
+  // can be filled without disabling interrupts.
+  lcd_pal_splits_pending = false;
+
+  uint8_t set = lcd_pal_splits_cur ^ 1;
+
+  memcpy(lcd_pal_splits[set], splits, num_splits * sizeof(lcd_pal_split_t));
+  lcd_pal_num_splits[set] = num_splits;
+
+  lcd_pal_splits_pending = true;
+
+  return LCD_SUCCESS;
+}  // lcd_set_palette_splits
+
+// Builds the palette of band b (b >= 1) by applying split b-1 to the
+// palette of the previous band. The buffer used by band b-2 is reused.
+const color_palette_t* lcd_pal_prepare(const lcd_pal_split_t* splits, uint8_t b) {
+  const color_palette_t* src = (b == 1) ? lcd_palette[lcd_pal_front] : lcd_pal_band_buf[b & 1];
+  color_palette_t* dst = lcd_pal_band_buf[(b - 1) & 1];
+  const lcd_pal_split_t* split = &splits[b - 1];
+
+  if (split->count < 256)
+    memcpy(dst, src, sizeof(lcd_pal_band_buf[0]));
+
+  memcpy(&dst[split->first], split->colors, split->count * sizeof(color_palette_t));
+
+  return dst;
+}  // lcd_pal_prepare
+
+// palette of band b of the current frame
+const color_palette_t* lcd_pal_band(uint8_t b) {
+  return (b == 0) ? lcd_palette[lcd_pal_front] : lcd_pal_band_buf[(b - 1) & 1];
+}  // lcd_pal_band
+
 void lcd_std_palette() {
+  color_palette_t* pal = lcd_get_palette_ptr();
+
   // calculate standard color palette of 256 colors
   int rr, gg, bb;
   int i = 0;
@@ -125,121 +365,362 @@ void lcd_std_palette() {
         if (bb > 31) bb = 31;
 
         //lcd_palette[i] = RGBColor565_565(rr, gg, bb);
-        lcd_palette[i] = rr << 11 | gg << 5 | bb;
+        pal[i] = rr << 11 | gg << 5 | bb;
 
         i++;
       }
 }
-#endif
 
-#if defined LCD_DOUBLE_PIXEL_NEAREST
-void tx_scanline() {
-
-  uint8_t corr = 0;
-
-  if (scanline_even) {
-    scanline_even = 0;
-    dma_scanline++;
-    // dma_scanline needs to be incremented before calling lcd_send_framebuffer to
-    // prevent a race condition in the ISR. However, dma_scanline also needs to be
-    // incremented after calling lcd_send_framebuffer for the buffer scanout to
-    // work properly. Hence the "corr" approach.
-    corr = 1;
-  } else {
-    scanline_even = 1;
+/* ------------------------- screen mode ------------------------- */
+uint16_t lcd_get_screen_width() {
+  return lcd_scr_width;
+}
+
+uint16_t lcd_get_screen_height() {
+  return lcd_scr_height;
+}
+
+uint8_t lcd_get_screen_bpp() {
+  return lcd_depth;
+}
+
+lcd_fitter_t lcd_get_fitter() {
+  return lcd_fitter;
+}
+
+// bytes per framebuffer line (packed lines start at a byte boundary)
+uint32_t lcd_line_bytes(uint16_t width) {
+  return (width * lcd_depth + 7) / 8;
+}
+
+// The content of the panel is no longer known (i.e. the checksums of the
+// lines sent and the border around the presentation window are lost).
+void lcd_screen_changed() {
+  lcd_crc_valid = false;
+  lcd_static_valid = false;
+  lcd_border_valid = false;
+}  // lcd_screen_changed
+
+/* -------------------------- row chains -------------------------- */
+// address of line y of the frame being sent
+void* __not_in_flash_func(lcd_scan_line)(coord_t y) {
+  if (cur_scanout_buf != NULL)
+    return (uint8_t*) cur_scanout_buf + y * lcd_scan_stride;
+
+  // composed frame: find the band holding line y
+  const lcd_comp_band_t* band = lcd_comp_bands;
+
+  while (y >= band->height) {
+    y -= band->height;
+    band++;
   }
 
-  lcd_send_framebuffer((void*)&cur_scanout_buf[(dma_scanline - corr) * SCREEN_WIDTH], SCREEN_WIDTH);
+  return &band->buf.data[(band->y + y) * gbuf_get_stride(band->buf) + band->x];
+}  // lcd_scan_line
 
-}  // txScanline_double_nearest 8 and 16 bits
-#endif
+// Sends a whole frame (or band) without CPU intervention: the control
+// channel reloads the data channel's read address from the row table after
+// every line. The NULL entry at the end stops the chain and raises the
+// (only) interrupt of the frame.
+void lcd_start_row_chain(volatile void* dst, uint32_t row_len, void** rows) {
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  // data channel: one line, then hand over to the control channel
+  dma_channel_configure(lcd_dma_chan[0], &lcd_dma_row_config, dst, NULL, row_len, false);
+
+  // control channel: load the next line pointer and trigger the data channel
+  dma_channel_configure(lcd_dma_ctrl_chan, &lcd_dma_ctrl_config, &dma_hw->ch[lcd_dma_chan[0]].al3_read_addr_trig, rows, 1, true);
+}  // lcd_start_row_chain
+
+// number of row table entries the control channel has fetched so far
+uint32_t lcd_row_chain_pos() {
+  return ((uintptr_t) dma_hw->ch[lcd_dma_ctrl_chan].read_addr - (uintptr_t) &lcd_row_table[0]) / sizeof(void*);
+}  // lcd_row_chain_pos
+
+// first framebuffer line of band b of the current frame
+coord_t lcd_band_line(uint8_t b) {
+  if (b == 0)
+    return 0;
+
+  if (b >= lcd_num_bands)
+    return lcd_frm_height;
+
+  return lcd_pal_splits[lcd_pal_splits_cur][b - 1].line;
+}  // lcd_band_line
+
+// true if core1 prepares the lines of the given mode (linear fitter, scaler,
+// packed lines and 8 bit lines if the palette lookup is done by core1)
+bool lcd_core1_mode(uint8_t depth, lcd_fitter_t fitter) {
+  if (fitter == LCD_FITTER_LINEAR || fitter == LCD_FITTER_SCALED || depth < 8)
+    return true;
 
-#if defined LCD_DOUBLE_PIXEL_LINEAR
-void tx_scanline() {
-  if (scanline_even) {
-    scanline_even = 0;
-    dma_scanline++;
-    lcd_send_framebuffer((void*)&scanline_buf_mid[0], SCREEN_WIDTH * 2);
+#ifdef LCD_PALETTE_CORE1
+  return depth == 8;
+#else
+  return false;
+#endif
+}  // lcd_core1_mode
+
+bool lcd_core1_lines() {
+  return lcd_core1_mode(lcd_depth, lcd_fitter);
+}  // lcd_core1_lines
+
+// true if the frame being sent needs a row chain (nearest neighbor, viewport
+// or composed frame)
+bool lcd_scan_rows() {
+  return lcd_fitter == LCD_FITTER_NEAREST || cur_scanout_buf == NULL ||
+         lcd_scan_stride != lcd_line_bytes(lcd_frm_width);
+}  // lcd_scan_rows
+
+// each line is listed once per physical line (i.e. twice for nearest
+// neighbor), every band ends with NULL
+void lcd_build_row_table(void* buf) {
+  // (composed frames are always rebuilt)
+  if (buf != NULL && lcd_row_table_buf == buf && lcd_row_table_stride == lcd_scan_stride &&
+      lcd_row_table_height == lcd_frm_height)
     return;
+
+  uint16_t row = 0;
+
+  for (uint8_t b = 0; b < lcd_num_bands; b++) {
+    lcd_band_row[b] = row;
+
+    for (coord_t y = lcd_band_line(b); y < lcd_band_line(b + 1); y++)
+      for (uint8_t i = 0; i < lcd_scale; i++)
+        lcd_row_table[row++] = lcd_scan_line(y);
+
+    lcd_row_table[row++] = NULL;
   }
 
-  // There is a bug here: dma_scanline is one ahead of the the scanline
-  // calculation so that in the end the final scanline is displayed on top.
-
-  uint16_t* scanline_buf_tmp = scanline_buf_lst;
-  scanline_buf_lst = &scanline_buf_nxt[0];
-  scanline_buf_nxt = scanline_buf_tmp;
-
-  // this looks like a fine(er) job for the RP2040 interpolator
-
-  if (dma_scanline < SCREEN_HEIGHT) {
-    for (uint16_t h = 0; h < SCREEN_WIDTH * 2 - 1; h++) {
-      if (h % 2 == 0)
-        scanline_buf_nxt[h] = cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2];
-      else {
-        #if LCD_COLORDEPTH == 8
-          uint8_t r1 = RGB565_red5(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2]);
-          uint8_t g1 = RGB565_green6(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2]);
-          uint8_t b1 = RGB565_blue5(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2]);
-          uint8_t r2 = RGB565_red5(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1]);
-          uint8_t g2 = RGB565_green6(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1]);
-          uint8_t b2 = RGB565_blue5(cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1]);
-        #elif LCD_COLORDEPTH == 16
-          uint8_t r1 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2] >> 11) & 0x1f;
-          uint8_t g1 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2] >> 5) & 0x3f;
-          uint8_t b1 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2] & 0x1f);
-          uint8_t r2 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1] >> 11) & 0x1f;
-          uint8_t g2 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1] >> 5) & 0x3f;
-          uint8_t b2 = (cur_scanout_buf[dma_scanline * SCREEN_WIDTH + h / 2 + 1] & 0x1f);
-        #endif
-        scanline_buf_nxt[h] = (r1 + r2) / 2 << 11 | (g1 + g2) / 2 << 5 | (b1 + b2) / 2;
-      }
-    }
+  lcd_row_table_buf = buf;
+  lcd_row_table_stride = lcd_scan_stride;
+  lcd_row_table_height = lcd_frm_height;
+}  // lcd_build_row_table
+
+/* ------------------------ linear fitter ------------------------- */
+// average of two RGB565 pixels (two pixels at once if packed into 32 bits)
+#define LCD_AVG565(a, b) (((((a) ^ (b)) & 0xF7DEF7DE) >> 1) + ((a) & (b)))
+
+uint16_t* lcd_lin_line(uint16_t j) {
+  return &lcd_line_buf[(j % LCD_LINE_BUFS) * LCD_PHYS_WIDTH];
+}  // lcd_lin_line
+
+// doubles a line horizontally: every second pixel is the average of its
+// neighbours, the last pixel is repeated (8 bit lines are converted
+// using the palette)
+void __not_in_flash_func(lcd_lin_hline)(const void* src, uint16_t* dst, const color_palette_t* pal) {
+  const uint8_t* src8 = (const uint8_t*) src;
+  const uint16_t* src16 = (const uint16_t*) src;
+  uint16_t width = lcd_frm_width;
+
+  uint32_t a = lcd_depth == 8 ? pal[src8[0]] : src16[0];
+
+  for (uint16_t x = 0; x < width - 1; x++) {
+    uint32_t b = lcd_depth == 8 ? pal[src8[x + 1]] : src16[x + 1];
+    dst[2 * x] = a;
+    dst[2 * x + 1] = LCD_AVG565(a, b);
+    a = b;
+  }
+
+  dst[2 * width - 2] = a;
+  dst[2 * width - 1] = a;
+}  // lcd_lin_hline
+
+// vertical average of two (horizontally doubled) lines
+void __not_in_flash_func(lcd_lin_vline)(const uint16_t* a, const uint16_t* b, uint16_t* dst) {
+  const uint32_t* a32 = (const uint32_t*) a;
+  const uint32_t* b32 = (const uint32_t*) b;
+  uint32_t* dst32 = (uint32_t*) dst;
+
+  for (uint16_t x = 0; x < lcd_frm_width; x++)
+    dst32[x] = LCD_AVG565(a32[x], b32[x]);
+}  // lcd_lin_vline
+
+// waits until the line previously held by the ring slot of line j has been sent
+void lcd_lin_wait_slot(uint16_t j, bool started) {
+  if (!started)
+    return;
+
+  // the line fetched last is still being sent
+  while (j >= LCD_LINE_BUFS + lcd_row_chain_pos() - 1);
+}  // lcd_lin_wait_slot
+
+/* ------------------ scaler and palette expansion ----------------- */
+// first physical line showing framebuffer line y
+uint16_t lcd_ring_first_row(uint16_t y) {
+  if (lcd_fitter == LCD_FITTER_SCALED)
+    return (y * LCD_PHYS_HEIGHT + lcd_frm_height - 1) / lcd_frm_height;
+
+  return y * lcd_scale;
+}  // lcd_ring_first_row
+
+// scales a line horizontally using the column map (8 bit lines are
+// converted using the palette)
+void __not_in_flash_func(lcd_sc_hline)(const void* src, uint16_t* dst, const color_palette_t* pal, const uint16_t* xmap) {
+  if (lcd_depth == 8) {
+    const uint8_t* src8 = (const uint8_t*) src;
+    for (uint16_t x = 0; x < LCD_PHYS_WIDTH; x++)
+      dst[x] = pal[src8[xmap[x]]];
   } else {
-    for (uint16_t h = 0; h < SCREEN_WIDTH * 2; h++)
-      scanline_buf_nxt[h] = 0;
+    const uint16_t* src16 = (const uint16_t*) src;
+    for (uint16_t x = 0; x < LCD_PHYS_WIDTH; x++)
+      dst[x] = src16[xmap[x]];
   }
+}  // lcd_sc_hline
+
+// converts an 8 bit line using the palette, four pixels per read (the PIO
+// doubles the pixels in nearest neighbor mode)
+void __not_in_flash_func(lcd_exp_hline)(const uint8_t* src, uint16_t* dst, const color_palette_t* pal) {
+  uint32_t* dst32 = (uint32_t*) dst;
+  uint16_t width = lcd_frm_width;
+  uint16_t x = 0;
+
+  // (the lines of a viewport may start at any byte)
+  if (((uintptr_t) src & 3) == 0) {
+    const uint32_t* src32 = (const uint32_t*) src;
+
+    for (; x + 4 <= width; x += 4) {
+      uint32_t p = *src32++;
+      *dst32++ = pal[p & 0xff] | (pal[(p >> 8) & 0xff] << 16);
+      *dst32++ = pal[(p >> 16) & 0xff] | (pal[p >> 24] << 16);
+    }
+  }
+
+  for (; x < width; x++)
+    dst[x] = pal[src[x]];
+}  // lcd_exp_hline
+
+// converts a packed line (4, 2 or 1 bpp) using the first entries of the palette
+void __not_in_flash_func(lcd_pk_hline)(const uint8_t* src, uint16_t* dst, const color_palette_t* pal) {
+  uint8_t bpp = lcd_depth;
+  uint8_t mask = (1 << bpp) - 1;
+  uint16_t width = lcd_frm_width;
+  uint16_t x = 0;
 
-  if (dma_scanline != 0) {
+  while (x < width) {
+    uint8_t p = *src++;
 
-    for (uint16_t h = 0; h < SCREEN_WIDTH * 2; h++) {
-      uint8_t r1 = (scanline_buf_nxt[h] >> 11) & 0x1f;
-      uint8_t g1 = (scanline_buf_nxt[h] >> 5) & 0x3f;
-      uint8_t b1 = (scanline_buf_nxt[h] & 0x1f);
-      uint8_t r2 = (scanline_buf_lst[h] >> 11) & 0x1f;
-      uint8_t g2 = (scanline_buf_lst[h] >> 5) & 0x3f;
-      uint8_t b2 = (scanline_buf_lst[h] & 0x1f);
-      scanline_buf_mid[h] = (r1 + r2) / 2 << 11 | (g1 + g2) / 2 << 5 | (b1 + b2) / 2;
+    for (int8_t shift = 8 - bpp; shift >= 0 && x < width; shift -= bpp)
+      dst[x++] = pal[(p >> shift) & mask];
+  }
+}  // lcd_pk_hline
+
+// Every framebuffer line is scaled or converted once into the ring, the row
+// table lists its ring slot for each physical line showing it.
+void __not_in_flash_func(lcd_ring_frame)() {
+  const uint16_t* xmap = &lcd_line_buf[LCD_LINE_BUFS * LCD_PHYS_WIDTH];
+  bool started = false;
+
+  const lcd_pal_split_t* splits = lcd_pal_splits[lcd_pal_splits_cur];
+  uint8_t num_splits = (lcd_depth <= 8) ? lcd_pal_num_splits[lcd_pal_splits_cur] : 0;
+  const color_palette_t* pal = lcd_palette[lcd_pal_front];
+  uint8_t band = 0;
+
+  for (uint16_t y = 0; y < lcd_frm_height; y++) {
+    while (band < num_splits && splits[band].line <= y)
+      pal = lcd_pal_prepare(splits, ++band);
+
+    // the slot is free once the last physical line of its previous
+    // framebuffer line has been sent (the row fetched last is in flight)
+    if (started && y >= LCD_LINE_BUFS)
+      while (lcd_row_chain_pos() <= lcd_ring_first_row(y - LCD_LINE_BUFS + 1));
+
+    if (lcd_fitter == LCD_FITTER_SCALED)
+      lcd_sc_hline(lcd_scan_line(y), lcd_lin_line(y), pal, xmap);
+    else if (lcd_depth == 8)
+      lcd_exp_hline((const uint8_t*) lcd_scan_line(y), lcd_lin_line(y), pal);
+    else
+      lcd_pk_hline((const uint8_t*) lcd_scan_line(y), lcd_lin_line(y), pal);
+
+    if (!started && (y == LCD_LINE_BUFS - 1 || y == lcd_frm_height - 1)) {
+      lcd_start_row_chain(&lcd_pio->txf[lcd_pio_tft_sm],
+                          lcd_fitter == LCD_FITTER_SCALED ? LCD_PHYS_WIDTH : lcd_frm_width, &lcd_row_table[0]);
+      started = true;
     }
   }
+}  // lcd_ring_frame
 
-  scanline_even = 1;
+// Core1 interpolates (scales or converts) the frame line by line into the
+// ring of line buffers ahead of the DMA. The row chain is started as soon as
+// the ring is full.
+void __not_in_flash_func(lcd_lin_core1)() {
+  uint32_t frame = lcd_lin_frame;
+  uint16_t* tmp = &lcd_line_buf[LCD_LINE_BUFS * LCD_PHYS_WIDTH];
 
-  lcd_send_framebuffer((void*)&scanline_buf_lst[0], SCREEN_WIDTH * 2);
+  while (true) {
+    while (lcd_lin_frame == frame)
+      __wfe();
 
-}  // txScanline_double_linear
-#endif
+    frame = lcd_lin_frame;
+
+    if (lcd_fitter != LCD_FITTER_LINEAR) {
+      lcd_ring_frame();
+      continue;
+    }
 
-#if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
+    uint16_t lines = lcd_frm_height * 2;
+    bool started = false;
+
+    // palette changes are applied by core1 itself (the LUT SM is not used)
+    const lcd_pal_split_t* splits = lcd_pal_splits[lcd_pal_splits_cur];
+    uint8_t num_splits = (lcd_depth == 8) ? lcd_pal_num_splits[lcd_pal_splits_cur] : 0;
+    const color_palette_t* pal = lcd_palette[lcd_pal_front];
+    uint8_t band = 0;
+
+    for (uint16_t j = 0; j < lines; j++) {
+      uint16_t y = j / 2;
+      uint16_t* dst = lcd_lin_line(j);
+
+      // palette of the source line converted next
+      uint16_t y_next = (j == 0) ? 0 : y + 1;
+      while (band < num_splits && splits[band].line <= y_next)
+        pal = lcd_pal_prepare(splits, ++band);
+
+      if (j == 0) {
+        lcd_lin_hline(lcd_scan_line(0), dst, pal);
+      } else if (j & 1) {
+        // next source line (the last one is repeated)
+        if (y + 1 < lcd_frm_height)
+          lcd_lin_hline(lcd_scan_line(y + 1), tmp, pal);
+        else
+          memcpy(tmp, lcd_lin_line(j - 1), lcd_frm_width * 4);
+
+        lcd_lin_wait_slot(j, started);
+        lcd_lin_vline(lcd_lin_line(j - 1), tmp, dst);
+      } else {
+        lcd_lin_wait_slot(j, started);
+        memcpy(dst, tmp, lcd_frm_width * 4);
+      }
+
+      if (!started && (j == LCD_LINE_BUFS - 1 || j == lines - 1)) {
+        lcd_start_row_chain(&lcd_pio->txf[lcd_pio_tft_sm], lcd_frm_width * 2, &lcd_row_table[0]);
+        started = true;
+      }
+    }
+  }
+}  // lcd_lin_core1
+
+/* ----------------------------- DMA ----------------------------- */
 void __isr lcd_dma_handler() {
   if (!dma_channel_get_irq0_status(lcd_dma_chan[0]))
     return;
 
   dma_channel_acknowledge_irq0(lcd_dma_chan[0]);  // clear irq flag
 
-  if (dma_scanline == SCREEN_HEIGHT) {
-    dma_scanline = 0;
-    mutex_exit(&lcd_scanout_complete);
-    return;
+  // (the DMA may have been used for something else than a frame, e.g. a
+  // partial update)
+  if (lcd_frame_active) {
+    // the frame is sent in bands using different palettes
+    if (lcd_band + 1 < lcd_num_bands)
+      lcd_band_next();
+    else
+      lcd_frame_done();
   }
 
-  // In nearest neighbor mode there is virtually no performance gain when using core1
-  // while linear fitting needs to be done with the interpolator anyways
-  //multicore_reset_core1();
-  //multicore_launch_core1(txScanline);
-  tx_scanline();
+  // wakes up the waits (on both cores) once the state has been updated
+  __sev();
 }  // lcd_dma_handler
-#endif
 
 bool lcd_dma_busy(void) {
   if (!lcd_dma_enabled)
@@ -251,40 +732,59 @@ bool lcd_dma_busy(void) {
     return false;
 }  // lcd_dma_busy
 
+// Sleeps until the next event. The DMA and TE ISRs signal every change of
+// the transfer state, within an ISR the waits just spin.
+void lcd_wait_event() {
+  if (__get_current_exception() == 0)
+    __wfe();
+}  // lcd_wait_event
+
 void lcd_dma_wait(void) {
   if (!lcd_dma_enabled)
     return;
 
-  while (dma_channel_is_busy(lcd_dma_chan[0]));
-}
+  // quiet transfers (command lists and row chains) don't raise the
+  // interrupt, command lists are short and frames are waited for by
+  // lcd_wait_ready
+  bool quiet = dma_channel_hw_addr(lcd_dma_chan[0])->al1_ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS;
 
-volatile uint32_t output;
+  while (dma_channel_is_busy(lcd_dma_chan[0]))
+    if (!quiet)
+      lcd_wait_event();
+}  // lcd_dma_wait
 
 lcd_error_t lcd_dma_init() {
   if (lcd_dma_enabled)
     return LCD_SUCCESS;
 
-  for (int h = 0; h < LCD_NUM_DMA; h++) {
-    lcd_dma_chan[h] = dma_claim_unused_channel(true);
+  lcd_dma_chan[0] = dma_claim_unused_channel(false);
+
+  if (lcd_dma_chan[0] < 0)
+    return LCD_DMA_ERR;
+
+  // setup IRQ (signals the end of a frame)
+  dma_channel_set_irq0_enabled(lcd_dma_chan[0], true);
+  irq_set_exclusive_handler(DMA_IRQ_0, lcd_dma_handler);
+  irq_set_enabled(DMA_IRQ_0, true);
+
+  lcd_dma_enabled = true;
+
+  return LCD_SUCCESS;
+}  // dmaInit
+
+// claims and starts the channels doing the palette lookup (8 bit mode)
+lcd_error_t lcd_dma_lut_enable() {
+  if (lcd_dma_chan[1] >= 0)
+    return LCD_SUCCESS;
+
+  for (int h = 1; h < LCD_NUM_DMA; h++) {
+    lcd_dma_chan[h] = dma_claim_unused_channel(false);
 
     if (lcd_dma_chan[h] < 0)
       return LCD_DMA_ERR;
-  }
 
-  for (int h = 0; h < LCD_NUM_DMA; h++)
     lcd_dma_config[h] = dma_channel_get_default_config(lcd_dma_chan[h]);
-
-  // WARNING: if DMA size is changed here, transmission length in lcd_show_framebuffer/lcd_send_framebuffer must also be revised
-  #if LCD_COLORDEPTH == 16
-  channel_config_set_transfer_data_size(&lcd_dma_config[0], DMA_SIZE_16);
-  channel_config_set_dreq(&lcd_dma_config[0], pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
-  channel_config_set_bswap(&lcd_dma_config[0], true);
-  #elif LCD_COLORDEPTH == 8
-  // Channel 0: user image buffer --> state machine
-  channel_config_set_transfer_data_size(&lcd_dma_config[0], DMA_SIZE_8);
-  channel_config_set_read_increment(&lcd_dma_config[0], true);
-  channel_config_set_write_increment(&lcd_dma_config[0], false);
-  channel_config_set_dreq(&lcd_dma_config[0], pio_get_dreq(lcd_pio, lcd_pio_lut_sm, true));
+  }
 
   // Channel 1: do the actual table lookup: state machine --> custom lut
   channel_config_set_transfer_data_size(&lcd_dma_config[1], DMA_SIZE_32);
@@ -298,7 +798,7 @@ lcd_error_t lcd_dma_init() {
   channel_config_set_write_increment(&lcd_dma_config[2], false);
   channel_config_set_dreq(&lcd_dma_config[2], pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
   channel_config_set_chain_to(&lcd_dma_config[2], lcd_dma_chan[1]);
-  channel_config_set_bswap(&lcd_dma_config[2], true);
+  channel_config_set_bswap(&lcd_dma_config[2], LCD_DMA_BSWAP);
 
   dma_channel_configure(lcd_dma_chan[1],
                         &lcd_dma_config[1],
@@ -311,218 +811,2061 @@ lcd_error_t lcd_dma_init() {
                         &lcd_pio->txf[lcd_pio_tft_sm],
                         NULL,
                         1, false);
-  #endif
 
-  // setup IRQ
-  #if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-    dma_channel_set_irq0_enabled(lcd_dma_chan[0], true);
-    irq_set_exclusive_handler(DMA_IRQ_0, lcd_dma_handler);
-    irq_set_enabled(DMA_IRQ_0, true);
-  #endif
+  return LCD_SUCCESS;
+}  // lcd_dma_lut_enable
 
-  lcd_dma_enabled = true;
+void lcd_dma_lut_disable() {
+  for (int h = 1; h < LCD_NUM_DMA; h++) {
+    if (lcd_dma_chan[h] < 0)
+      continue;
 
-  return LCD_SUCCESS;
-}  // dmaInit
+    dma_channel_abort(lcd_dma_chan[h]);
+    dma_channel_unclaim(lcd_dma_chan[h]);
+    lcd_dma_chan[h] = -1;
+  }
+}  // lcd_dma_lut_disable
+
+// (re)builds the configuration of channel 0 for the current mode
+void lcd_dma_setup_configs() {
+  // WARNING: if DMA size is changed here, transmission length in lcd_show_framebuffer/lcd_send_framebuffer must also be revised
+  lcd_dma_config[0] = dma_channel_get_default_config(lcd_dma_chan[0]);
+
+  // (8 bit lines converted by core1 are sent as RGB565 as well)
+  if (lcd_depth == 16 || lcd_pio_lut_sm < 0) {
+    channel_config_set_transfer_data_size(&lcd_dma_config[0], DMA_SIZE_16);
+    channel_config_set_dreq(&lcd_dma_config[0], pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
+    channel_config_set_bswap(&lcd_dma_config[0], LCD_DMA_BSWAP);
+  } else {
+    // Channel 0: user image buffer --> state machine
+    channel_config_set_transfer_data_size(&lcd_dma_config[0], DMA_SIZE_8);
+    channel_config_set_read_increment(&lcd_dma_config[0], true);
+    channel_config_set_write_increment(&lcd_dma_config[0], false);
+    channel_config_set_dreq(&lcd_dma_config[0], pio_get_dreq(lcd_pio, lcd_pio_lut_sm, true));
+  }
+
+  if (lcd_dma_ctrl_chan < 0)
+    return;
+
+  // Channel 0 for row chains: no interrupt per line (only on the NULL
+  // trigger at the end of the table), hand over to the control channel
+  if (lcd_core1_lines()) {
+    // interpolated and scaled lines are always RGB565 and bypass the palette
+    lcd_dma_row_config = dma_channel_get_default_config(lcd_dma_chan[0]);
+    channel_config_set_transfer_data_size(&lcd_dma_row_config, DMA_SIZE_16);
+    channel_config_set_dreq(&lcd_dma_row_config, pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
+    channel_config_set_bswap(&lcd_dma_row_config, LCD_DMA_BSWAP);
+  } else {
+    lcd_dma_row_config = lcd_dma_config[0];
+  }
+  channel_config_set_chain_to(&lcd_dma_row_config, lcd_dma_ctrl_chan);
+  channel_config_set_irq_quiet(&lcd_dma_row_config, true);
+
+  // Control channel: row table --> channel 0 read address (and trigger)
+  lcd_dma_ctrl_config = dma_channel_get_default_config(lcd_dma_ctrl_chan);
+  channel_config_set_transfer_data_size(&lcd_dma_ctrl_config, DMA_SIZE_32);
+  channel_config_set_read_increment(&lcd_dma_ctrl_config, true);
+  channel_config_set_write_increment(&lcd_dma_ctrl_config, false);
+}  // lcd_dma_setup_configs
 
 void lcd_dma_shutdown(void) {
   if (!lcd_dma_enabled)
     return;
 
+  lcd_dma_lut_disable();
+
   dma_channel_unclaim(lcd_dma_chan[0]);
+  lcd_dma_chan[0] = -1;
+
+  if (lcd_dma_ctrl_chan >= 0) {
+    dma_channel_unclaim(lcd_dma_ctrl_chan);
+    lcd_dma_ctrl_chan = -1;
+  }
+
+  if (lcd_dma_crc_chan >= 0) {
+    dma_channel_unclaim(lcd_dma_crc_chan);
+    lcd_dma_crc_chan = -1;
+  }
 
   lcd_dma_enabled = false;
 }  // lcd_dma_shutdown
 
 int lcd_check_ready() {
-
-#if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-  // if mutex has no owen, then the tx is complete
-  if (lcd_scanout_complete.owner == -1)
-    return true;
-  else
+  // a frame is complete when the ISR has seen its last transfer
+  if (lcd_frame_active || lcd_dma_busy())
     return false;
-#else
-  return lcd_dma_busy();
-#endif
-
+  else
+    return true;
 }  // lcd_check_ready
 
 void lcd_wait_ready() {
-#if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-  while (!mutex_try_enter(&lcd_scanout_complete, NULL));
-  mutex_exit(&lcd_scanout_complete);
-#else
+  while (lcd_frame_active)
+    lcd_wait_event();
   lcd_dma_wait();
-#endif
 }  // lcd_wait_ready
 
-lcd_error_t lcd_show_framebuffer(gbuffer_t buf) {
-  lcd_dma_wait();
-  #if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-    mutex_enter_blocking(&lcd_scanout_complete);
-  #endif
+void lcd_set_frame_callback(lcd_frame_cb_t callback) {
+  lcd_frame_callback = callback;
+}  // lcd_set_frame_callback
+
+// Palette changes requested by the user take effect at the start of a
+// frame. Also restores the front palette after a frame sent in bands.
+void lcd_pal_frame_start() {
+  if (lcd_pal_flip_pending) {
+    lcd_pal_front ^= 1;
+    lcd_pal_back_stale = true;
+    lcd_pal_flip_pending = false;
+  }
 
-  cur_scanout_buf = buf.data;
+  if (lcd_pal_splits_pending) {
+    lcd_pal_splits_cur ^= 1;
+    lcd_pal_splits_pending = false;
+    lcd_row_table_buf = NULL;
+  }
 
-  #if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-  //multicore_reset_core1();
-  //multicore_launch_core1(txScanline);
-  tx_scanline();
-  return LCD_SUCCESS;
-  #else
-  // same length in both 16 and 8 bits --> different DMA_SIZE
-  return lcd_send_framebuffer(buf.data, gbuf_get_width(buf) * gbuf_get_height(buf));
-  #endif
-}  // lcd_show_framebuffer
+  if (lcd_pio_lut_sm >= 0)
+    lcd_pal_select(lcd_palette[lcd_pal_front]);
+}  // lcd_pal_frame_start
 
-void lcd_set_speed(uint32_t freq) {
-  //  if (!initComplete)
-  //    return LCD_NOT_INIT;
+// starts sending band lcd_band of the current frame
+void lcd_band_start() {
+  coord_t y = lcd_band_line(lcd_band);
 
-  uint32_t fcpu = clock_get_hz(clk_sys);
+  if (lcd_scan_rows())
+    lcd_start_row_chain(&lcd_pio->txf[lcd_pio_data_sm], lcd_frm_width, &lcd_row_table[lcd_band_row[lcd_band]]);
+  else
+    lcd_send_framebuffer((uint8_t*) cur_scanout_buf + y * lcd_scan_stride,
+                         (lcd_band_line(lcd_band + 1) - y) * lcd_frm_width);
+
+  // the palette of the next band is prepared while this one is being sent
+  if (lcd_band + 1 < lcd_num_bands)
+    lcd_pal_prepare(lcd_pal_splits[lcd_pal_splits_cur], lcd_band + 1);
+}  // lcd_band_start
+
+// called by the DMA ISR after the last transfer of a band
+void lcd_band_next() {
+  lcd_band++;
+  lcd_pal_select(lcd_pal_band(lcd_band));
+  lcd_band_start();
+}  // lcd_band_next
+
+// Starts sending a frame of width x height pixels (lines stride bytes
+// apart) into the current window and returns immediately. The bus must be
+// idle.
+lcd_error_t lcd_start_scan(void* data, uint32_t stride, uint16_t width, uint16_t height) {
+  lcd_pal_frame_start();
+
+  cur_scanout_buf = data;
+  lcd_scan_stride = stride;
+  lcd_frm_width = width;
+  lcd_frm_height = height;
+  lcd_frame_active = true;
+
+  if (lcd_core1_lines()) {
+    // move the end of the row table to the last line of this frame
+    if (lcd_fitter == LCD_FITTER_LINEAR && lcd_lin_rows != height * 2) {
+      lcd_row_table[lcd_lin_rows] = lcd_lin_line(lcd_lin_rows);
+      lcd_lin_rows = height * 2;
+      lcd_row_table[lcd_lin_rows] = NULL;
+    }
 
-  uint16_t clock_div = fcpu / freq;
-  uint16_t fract_div = (uint16_t)(((float)fcpu / (float)freq - (float)clock_div) * 256.0);
+    // palette expansion: each converted line is listed once per physical line
+    if (lcd_fitter != LCD_FITTER_LINEAR && lcd_fitter != LCD_FITTER_SCALED &&
+        lcd_lin_rows != height * lcd_scale) {
+      for (uint16_t j = 0; j < height * lcd_scale; j++)
+        lcd_row_table[j] = lcd_lin_line(j / lcd_scale);
+      lcd_lin_rows = height * lcd_scale;
+      lcd_row_table[lcd_lin_rows] = NULL;
+    }
 
-  // max speed exceeded
-  if (clock_div == 0) {
-    clock_div = 1;
-    fract_div = 0;
+    // core1 starts the transfer once it is ahead far enough
+    lcd_lin_frame++;
+    __sev();
+    return LCD_SUCCESS;
   }
 
-  // Set clock divider and fractional divider
-  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, false);
-  pio_sm_set_clkdiv_int_frac(lcd_pio, lcd_pio_tft_sm, clock_div, fract_div);
-  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, true);
+  // palette changes split the frame into bands (8 bit only), changes
+  // below the frame do not apply
+  lcd_num_bands = 1;
+  if (lcd_depth == 8)
+    while (lcd_num_bands <= lcd_pal_num_splits[lcd_pal_splits_cur] &&
+           lcd_pal_splits[lcd_pal_splits_cur][lcd_num_bands - 1].line < height)
+      lcd_num_bands++;
 
-  #if LCD_COLORDEPTH == 8
-  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, false);
-  pio_sm_set_clkdiv_int_frac(lcd_pio, lcd_pio_lut_sm, clock_div, fract_div);
-  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, true);
-  #endif
-  
-}  // lcd_set_speed
+  lcd_band = 0;
 
-lcd_error_t lcd_pio_init() {
+  if (lcd_scan_rows())
+    lcd_build_row_table(data);
 
-  lcd_pio_tft_sm = pio_claim_unused_sm(lcd_pio, false);
+  // the first band is empty if the palette is changed at line 0
+  if (lcd_band_line(1) == 0) {
+    lcd_band = 1;
+    lcd_pal_select(lcd_pal_prepare(lcd_pal_splits[lcd_pal_splits_cur], 1));
+  }
 
-  if (lcd_pio_tft_sm < 0)
-    return LCD_PIO_ERR;
+  lcd_band_start();
 
-  uint32_t program_offset = pio_add_program(lcd_pio, &lcd_output_program);
+  return LCD_SUCCESS;
+}  // lcd_start_scan
 
-  pio_gpio_init(lcd_pio, PIN_LCD_WR);
+// Starts sending a full screen frame and returns immediately. The bus must
+// be idle.
+lcd_error_t lcd_start_frame(void* data, uint32_t stride) {
+  if (!lcd_window_full)
+    lcd_reset_window();
 
-  for (int i = 0; i < 8; i++)
-    pio_gpio_init(lcd_pio, PIN_LCD_D0 + i);
+  lcd_screen_changed();
 
-  pio_sm_set_consecutive_pindirs(lcd_pio, lcd_pio_tft_sm, PIN_LCD_WR, 1, true);
-  pio_sm_set_consecutive_pindirs(lcd_pio, lcd_pio_tft_sm, PIN_LCD_D0, 8, true);
+  return lcd_start_scan(data, stride, lcd_scr_width, lcd_scr_height);
+}  // lcd_start_frame
 
-  pio_sm_config c = lcd_output_program_get_default_config(program_offset);
+// full frames are sent from buffers of the screen size
+bool lcd_is_screen_size(uint16_t width, uint16_t height) {
+  return width == lcd_scr_width && height == lcd_scr_height;
+}  // lcd_is_screen_size
 
-  sm_config_set_sideset_pins(&c, PIN_LCD_WR);
-  sm_config_set_out_pins(&c, PIN_LCD_D0, 8);
-  sm_config_set_clkdiv_int_frac(&c, 10, 1);
-  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
-  sm_config_set_out_shift(&c, true, true, 16);  // OSR shifts out to the right, autopull, pull threshold is 16 bits
+lcd_error_t lcd_show_data(void* data) {
+  uint32_t crc = 0;
+  bool crc_valid = false;
 
-  pio_sm_init(lcd_pio, lcd_pio_tft_sm, program_offset + lcd_output_offset_tx_dat, &c);  // ori
-  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, true);
+  // static screens: nothing is sent while the frame is unchanged
+  if (lcd_static_active) {
+    crc_valid = lcd_frame_crc(data, &crc);
 
-  pio_pull_stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + lcd_pio_tft_sm);  // ori
-  pio_instr_jmp8 = pio_encode_jmp(program_offset + lcd_output_offset_tx_cmd);
+    if (crc_valid && lcd_static_valid && crc == lcd_static_crc)
+      return LCD_SUCCESS;
+  }
 
-#if LCD_COLORDEPTH == 8
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
 
-  lcd_pio_lut_sm = pio_claim_unused_sm(lcd_pio, true);
+  lcd_wait_ready();
 
-  if (lcd_pio_lut_sm < 0)
-    return LCD_PIO_ERR;
+  lcd_error_t err = lcd_start_frame(data, lcd_line_bytes(lcd_scr_width));
 
-  program_offset = pio_add_program(lcd_pio, &calc_lut_addr_program);
+  lcd_static_crc = crc;
+  lcd_static_valid = crc_valid && err == LCD_SUCCESS;
 
-  c = calc_lut_addr_program_get_default_config(program_offset);
+  return err;
+}  // lcd_show_data
 
-  sm_config_set_out_shift(&c, true, false, 8);  // OSR shifts out to the right, autopull, pull threshold is 16 bits
-  sm_config_set_in_shift(&c, false, false, 8);  // ISR shifts in the left, no auto push, push doesn't matter
+lcd_error_t lcd_show_framebuffer(gbuffer8_t buf) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
 
-  pio_sm_init(lcd_pio, lcd_pio_lut_sm, program_offset + calc_lut_addr_offset_calc_lut_entry, &c);  // ori
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
 
-  // Load base address to state machine register x
-  uint32_t addrbase = (uint32_t)&lcd_palette[0];
+  if (buf.stride != 0)
+    return lcd_show_view((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), 0, 0);
 
-  assert((addrbase & 0x1FF) == 0);
+  return lcd_show_data((void*) buf.data);
+}  // lcd_show_framebuffer
 
-  pio_sm_put(lcd_pio, lcd_pio_lut_sm, addrbase >> 9);
-  pio_sm_exec(lcd_pio, lcd_pio_lut_sm, pio_encode_pull(false, false));
-  pio_sm_exec(lcd_pio, lcd_pio_lut_sm, pio_encode_mov(pio_x, pio_osr));
+lcd_error_t lcd_show_framebuffer(gbuffer16_t buf) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
 
-  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, true);
-#endif
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
 
-  return LCD_SUCCESS;
-}  // pioInit
+  if (buf.stride != 0)
+    return lcd_show_view((void*) buf.data, gbuf_get_stride(buf) * 2, gbuf_get_width(buf), gbuf_get_height(buf), 0, 0);
 
-void lcd_pio_wait() {
-  // Wait for the PIO to stall (SM pull request finds no data in TX FIFO)
-  // This is used to detect when the SM is idle and hence ready for a jump instruction
-  lcd_pio->fdebug = pio_pull_stall_mask;
-  while (!(lcd_pio->fdebug & pio_pull_stall_mask));
-}  // lcd_pio_wait
+  return lcd_show_data((void*) buf.data);
+}  // lcd_show_framebuffer
 
-void set_rs(byte value) {
-  digitalWrite(PIN_LCD_DC, value);
-}
+lcd_error_t lcd_show_framebuffer(gbuffer_packed_t buf) {
+  if (lcd_depth != buf.bpp)
+    return LCD_NOT_SUPPORTED;
 
-void set_rst(byte value) {
-  digitalWrite(PIN_LCD_RST, value);
-}
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
 
-void lcd_send_dat_byte(uint8_t dat) {
-  // jump to pio_instr_jmp8
-  lcd_pio->sm[lcd_pio_tft_sm].instr = pio_instr_jmp8;
+  if (buf.stride != 0)
+    return lcd_show_view((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), 0, 0);
 
-  // write dat to SM FIFO
-  lcd_pio->txf[lcd_pio_tft_sm] = dat;
+  return lcd_show_data((void*) buf.data);
+}  // lcd_show_framebuffer
 
-  lcd_pio_wait();
-}  // lcd_send_dat_byte
+// Without a panel fitter, the control channel of the row chains is only
+// claimed when needed. The bus must be idle.
+lcd_error_t lcd_dma_ctrl_claim() {
+  if (lcd_dma_ctrl_chan >= 0)
+    return LCD_SUCCESS;
+
+  lcd_dma_ctrl_chan = dma_claim_unused_channel(false);
+
+  if (lcd_dma_ctrl_chan < 0)
+    return LCD_DMA_ERR;
+
+  lcd_dma_setup_configs();
+
+  return LCD_SUCCESS;
+}  // lcd_dma_ctrl_claim
+
+// Sends the screen sized part of a larger buffer starting at (x, y). The
+// lines are picked by a row chain, so no pixels need to be copied (stride:
+// bytes from one line of the buffer to the next).
+lcd_error_t lcd_show_view(void* data, uint32_t stride, uint16_t buf_width, uint16_t buf_height, coord_t x, coord_t y) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  if (x < 0 || y < 0 || x + lcd_scr_width > buf_width || y + lcd_scr_height > buf_height)
+    return LCD_INVALID_PARAM;
+
+  // packed lines need to start at a byte boundary
+  if ((x * lcd_depth) % 8 != 0)
+    return LCD_INVALID_PARAM;
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+
+  lcd_wait_ready();
+
+  if (lcd_dma_ctrl_claim() != LCD_SUCCESS)
+    return LCD_DMA_ERR;
+
+  return lcd_start_frame((uint8_t*) data + y * stride + x * lcd_depth / 8, stride);
+}  // lcd_show_view
+
+lcd_error_t lcd_show_framebuffer_view(gbuffer8_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_view((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_view
+
+lcd_error_t lcd_show_framebuffer_view(gbuffer16_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_view((void*) buf.data, gbuf_get_stride(buf) * 2, gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_view
+
+lcd_error_t lcd_show_framebuffer_view(gbuffer_packed_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != buf.bpp)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_view((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_view
+
+/* ------------------------ band compositor ------------------------ */
+// Sends a frame made of bands of lines taken from different buffers (top
+// down). The row chain streams them in sequence, nothing is copied.
+lcd_error_t lcd_show_composed(const lcd_comp_band_t* bands, uint8_t num_bands) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  // the type of gbuffer_t is fixed at compile time
+  if (lcd_depth != LCD_COLORDEPTH)
+    return LCD_NOT_SUPPORTED;
+
+  if (num_bands == 0 || num_bands > LCD_COMP_MAX_BANDS)
+    return LCD_INVALID_PARAM;
+
+  uint16_t lines = 0;
+
+  for (uint8_t h = 0; h < num_bands; h++) {
+    const lcd_comp_band_t* band = &bands[h];
+
+    if (band->buf.data == NULL || band->height <= 0 || band->x < 0 || band->y < 0 ||
+        band->x + lcd_scr_width > gbuf_get_width(band->buf) ||
+        band->y + band->height > gbuf_get_height(band->buf))
+      return LCD_INVALID_PARAM;
+
+    lines += band->height;
+  }
+
+  // the bands must cover the screen exactly
+  if (lines != lcd_scr_height)
+    return LCD_INVALID_PARAM;
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+
+  lcd_wait_ready();
+
+  if (lcd_dma_ctrl_claim() != LCD_SUCCESS)
+    return LCD_DMA_ERR;
+
+  // the list is used while the frame is being sent
+  memcpy(lcd_comp_bands, bands, num_bands * sizeof(lcd_comp_band_t));
+
+  return lcd_start_frame(NULL, 0);
+}  // lcd_show_composed
+
+/* --------------------- windowed presentation --------------------- */
+void lcd_set_border_color(uint16_t color) {
+  lcd_border_color = color;
+  lcd_border_valid = false;
+}  // lcd_set_border_color
+
+// fills the given area of the panel (physical coordinates, inclusive)
+void lcd_fill_area(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+  if (x2 < x1 || y2 < y1)
+    return;
+
+  lcd_set_window(x1, y1, x2, y2);
+  lcd_send_fill(lcd_border_color, (x2 - x1 + 1) * (y2 - y1 + 1));
+}  // lcd_fill_area
+
+// Sends a buffer of width x height pixels into the window at (x, y) (screen
+// coordinates). The area around the window is filled whenever the window
+// has changed or the screen has been overwritten by another function.
+lcd_error_t lcd_show_at(void* data, uint32_t stride, uint16_t width, uint16_t height, coord_t x, coord_t y) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  // the scaler's row table always covers the whole screen
+  if (lcd_fitter == LCD_FITTER_SCALED)
+    return LCD_NOT_SUPPORTED;
+
+  if (x < 0 || y < 0 || width == 0 || height == 0 ||
+      x + width > lcd_scr_width || y + height > lcd_scr_height)
+    return LCD_INVALID_PARAM;
+
+#ifdef LCD_BUS_RGB444
+  // pixels are sent in pairs
+  if (width & 1)
+    return LCD_INVALID_PARAM;
+#endif
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+
+  lcd_wait_ready();
+
+  // the lines of a view are picked by a row chain
+  if (stride != lcd_line_bytes(width) && lcd_dma_ctrl_claim() != LCD_SUCCESS)
+    return LCD_DMA_ERR;
+
+  // physical window
+  lcd_rect_t win = { (coord_t) (x * lcd_scale), (coord_t) (y * lcd_scale),
+                     (coord_t) ((x + width) * lcd_scale - 1), (coord_t) ((y + height) * lcd_scale - 1) };
+
+  if (!lcd_border_valid || memcmp(&win, &lcd_border_win, sizeof(win)) != 0) {
+    lcd_fill_area(0, 0, LCD_PHYS_WIDTH - 1, win.y1 - 1);
+    lcd_fill_area(0, win.y2 + 1, LCD_PHYS_WIDTH - 1, LCD_PHYS_HEIGHT - 1);
+    lcd_fill_area(0, win.y1, win.x1 - 1, win.y2);
+    lcd_fill_area(win.x2 + 1, win.y1, LCD_PHYS_WIDTH - 1, win.y2);
+
+    lcd_border_win = win;
+    lcd_border_valid = true;
+  }
+
+  lcd_set_window(win.x1, win.y1, win.x2, win.y2);
+  lcd_crc_valid = false;
+  lcd_static_valid = false;
+
+  return lcd_start_scan(data, stride, width, height);
+}  // lcd_show_at
+
+lcd_error_t lcd_show_framebuffer_at(gbuffer8_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_at((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_at
+
+lcd_error_t lcd_show_framebuffer_at(gbuffer16_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_at((void*) buf.data, gbuf_get_stride(buf) * 2, gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_at
+
+lcd_error_t lcd_show_framebuffer_at(gbuffer_packed_t buf, coord_t x, coord_t y) {
+  if (lcd_depth != buf.bpp)
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_at((void*) buf.data, gbuf_get_stride(buf), gbuf_get_width(buf), gbuf_get_height(buf), x, y);
+}  // lcd_show_framebuffer_at
+
+/* ----------------------------- PIO ----------------------------- */
+void lcd_set_speed(uint32_t freq) {
+  //  if (!initComplete)
+  //    return LCD_NOT_INIT;
+
+  uint32_t fcpu = clock_get_hz(clk_sys);
+
+  uint16_t clock_div = fcpu / freq;
+  uint16_t fract_div = (uint16_t)(((float)fcpu / (float)freq - (float)clock_div) * 256.0);
+
+  // max speed exceeded
+  if (clock_div == 0) {
+    clock_div = 1;
+    fract_div = 0;
+  }
+
+  // also used when the state machines are set up again on a mode change
+  lcd_pio_clk_div = clock_div;
+  lcd_pio_clk_frac = fract_div;
+
+  // Set clock divider and fractional divider
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, false);
+  pio_sm_set_clkdiv_int_frac(lcd_pio, lcd_pio_tft_sm, clock_div, fract_div);
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, true);
+
+  if (lcd_pio_lut_sm >= 0) {
+    pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, false);
+    pio_sm_set_clkdiv_int_frac(lcd_pio, lcd_pio_lut_sm, clock_div, fract_div);
+    pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, true);
+  }
+  
+}  // lcd_set_speed
+
+// sets up the TFT state machine with the plain or the doublescan program
+// (or the RGB444 program, which replaces both)
+void lcd_pio_tft_setup(bool doublescan) {
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, false);
+
+  pio_sm_config c;
+  uint32_t entry, cmd;
+
+#ifdef LCD_BUS_RGB444
+  c = lcd_output_444_program_get_default_config(lcd_pio_ofs_plain);
+  entry = lcd_pio_ofs_plain + lcd_output_444_offset_tx_dat;
+  cmd = lcd_pio_ofs_plain + lcd_output_444_offset_tx_cmd;
+  doublescan = false;
+#else
+  if (doublescan) {
+    c = lcd_output_ds_program_get_default_config(lcd_pio_ofs_ds);
+    entry = lcd_pio_ofs_ds + lcd_output_ds_offset_tx_dat;
+    cmd = lcd_pio_ofs_ds + lcd_output_ds_offset_tx_cmd;
+  } else {
+    c = lcd_output_program_get_default_config(lcd_pio_ofs_plain);
+    entry = lcd_pio_ofs_plain + lcd_output_offset_tx_dat;
+    cmd = lcd_pio_ofs_plain + lcd_output_offset_tx_cmd;
+  }
+#endif
+
+  sm_config_set_sideset_pins(&c, PIN_LCD_WR);
+  sm_config_set_out_pins(&c, PIN_LCD_D0, 8);
+  sm_config_set_set_pins(&c, PIN_LCD_DC, 1);  // DC is set by exec'd instructions
+  sm_config_set_clkdiv_int_frac(&c, lcd_pio_clk_div, lcd_pio_clk_frac);
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+#ifdef LCD_BUS_RGB444
+  sm_config_set_out_shift(&c, false, true, 15);  // OSR shifts out to the left, autopull, the LSB of each pixel is dropped
+  sm_config_set_in_shift(&c, false, false, 32);  // ISR shifts in from the right, no auto push
+#else
+  sm_config_set_out_shift(&c, true, true, 16);  // OSR shifts out to the right, autopull, pull threshold is 16 bits
+#endif
+
+  pio_sm_init(lcd_pio, lcd_pio_tft_sm, entry, &c);  // ori
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, true);
+
+  pio_instr_jmp8 = pio_encode_jmp(cmd);
+
+  lcd_pio_ds_active = doublescan;
+}  // lcd_pio_tft_setup
+
+// sets up the TFT state machine with the command list program (the bus must be idle)
+void lcd_pio_cmdlist_setup() {
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, false);
+
+  pio_sm_config c = lcd_cmdlist_program_get_default_config(lcd_pio_ofs_cmdlist);
+
+  sm_config_set_sideset_pins(&c, PIN_LCD_WR);
+  sm_config_set_out_pins(&c, PIN_LCD_DC, LCD_CMDLIST_PINS);
+  sm_config_set_clkdiv_int_frac(&c, lcd_pio_clk_div, lcd_pio_clk_frac);
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+  sm_config_set_out_shift(&c, true, true, 16);  // OSR shifts out to the right, autopull, pull threshold is 16 bits
+
+  pio_sm_init(lcd_pio, lcd_pio_tft_sm, lcd_pio_ofs_cmdlist, &c);
+  pio_sm_set_enabled(lcd_pio, lcd_pio_tft_sm, true);
+}  // lcd_pio_cmdlist_setup
+
+// claims and starts the state machine calculating the palette addresses
+lcd_error_t lcd_pio_lut_enable() {
+  if (lcd_pio_lut_sm >= 0)
+    return LCD_SUCCESS;
+
+  lcd_pio_lut_sm = pio_claim_unused_sm(lcd_pio, false);
+
+  if (lcd_pio_lut_sm < 0)
+    return LCD_PIO_ERR;
+
+  pio_sm_config c = calc_lut_addr_program_get_default_config(lcd_pio_ofs_lut);
+
+  sm_config_set_out_shift(&c, true, false, 8);  // OSR shifts out to the right, autopull, pull threshold is 16 bits
+  sm_config_set_in_shift(&c, false, false, 8);  // ISR shifts in the left, no auto push, push doesn't matter
+  sm_config_set_clkdiv_int_frac(&c, lcd_pio_clk_div, lcd_pio_clk_frac);
+
+  pio_sm_init(lcd_pio, lcd_pio_lut_sm, lcd_pio_ofs_lut + calc_lut_addr_offset_calc_lut_entry, &c);  // ori
+
+  lcd_pal_lut_base = NULL;
+  lcd_pal_select(lcd_palette[lcd_pal_front]);
+
+  return LCD_SUCCESS;
+}  // lcd_pio_lut_enable
+
+// Waits until every pixel handed to the LUT SM has been looked up and sent
+// to the TFT SM. DMA channel 0 must have finished.
+void lcd_pio_lut_drain() {
+  uint32_t lut_stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + lcd_pio_lut_sm);
+
+  lcd_pio->fdebug = lut_stall_mask;
+  while (!(lcd_pio->fdebug & lut_stall_mask));
+
+  while (!pio_sm_is_rx_fifo_empty(lcd_pio, lcd_pio_lut_sm) || dma_channel_is_busy(lcd_dma_chan[2]));
+
+  lcd_pio_wait();
+}  // lcd_pio_lut_drain
+
+// makes the LUT SM look up colors in the given (512 byte aligned) palette
+void lcd_pal_select(const color_palette_t* pal) {
+  if (pal == lcd_pal_lut_base)
+    return;
+
+  uint32_t addrbase = (uintptr_t) pal;
+
+  assert((addrbase & 0x1FF) == 0);
+
+  // pixels of the previous palette may still be on their way
+  if (lcd_pal_lut_base != NULL)
+    lcd_pio_lut_drain();
+
+  // Load base address to state machine register x (the SM is stalled on
+  // its pull and continues there)
+  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, false);
+  pio_sm_put(lcd_pio, lcd_pio_lut_sm, addrbase >> 9);
+  pio_sm_exec(lcd_pio, lcd_pio_lut_sm, pio_encode_pull(false, false));
+  pio_sm_exec(lcd_pio, lcd_pio_lut_sm, pio_encode_mov(pio_x, pio_osr));
+  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, true);
+
+  lcd_pal_lut_base = pal;
+}  // lcd_pal_select
+
+void lcd_pio_lut_disable() {
+  if (lcd_pio_lut_sm < 0)
+    return;
+
+  pio_sm_set_enabled(lcd_pio, lcd_pio_lut_sm, false);
+  pio_sm_unclaim(lcd_pio, lcd_pio_lut_sm);
+
+  lcd_pio_lut_sm = -1;
+}  // lcd_pio_lut_disable
+
+lcd_error_t lcd_pio_init() {
+
+  lcd_pio_tft_sm = pio_claim_unused_sm(lcd_pio, false);
+
+  if (lcd_pio_tft_sm < 0)
+    return LCD_PIO_ERR;
+
+  // all programs are loaded once, so a mode change only needs to restart
+  // the state machines
+#ifdef LCD_BUS_RGB444
+  // there is no room for the other TFT programs (the sound needs 7 instructions)
+  lcd_pio_ofs_plain = pio_add_program(lcd_pio, &lcd_output_444_program);
+#else
+  lcd_pio_ofs_plain = pio_add_program(lcd_pio, &lcd_output_program);
+  lcd_pio_ofs_ds = pio_add_program(lcd_pio, &lcd_output_ds_program);
+#endif
+#ifndef LCD_PALETTE_CORE1
+  lcd_pio_ofs_lut = pio_add_program(lcd_pio, &calc_lut_addr_program);
+#endif
+  lcd_pio_ofs_cmdlist = pio_add_program(lcd_pio, &lcd_cmdlist_program);
+
+  // DC is driven by the PIO as well, so it can be part of command lists
+  pio_gpio_init(lcd_pio, PIN_LCD_DC);
+  pio_gpio_init(lcd_pio, PIN_LCD_WR);
+
+  for (int i = 0; i < 8; i++)
+    pio_gpio_init(lcd_pio, PIN_LCD_D0 + i);
+
+  pio_sm_set_consecutive_pindirs(lcd_pio, lcd_pio_tft_sm, PIN_LCD_DC, 1, true);
+  pio_sm_set_consecutive_pindirs(lcd_pio, lcd_pio_tft_sm, PIN_LCD_WR, 1, true);
+  pio_sm_set_consecutive_pindirs(lcd_pio, lcd_pio_tft_sm, PIN_LCD_D0, 8, true);
+
+  lcd_pio_tft_setup(LCD_INIT_FITTER == LCD_FITTER_NEAREST);
+
+  pio_pull_stall_mask = 1u << (PIO_FDEBUG_TXSTALL_LSB + lcd_pio_tft_sm);  // ori
+
+  set_rs(HIGH);
+
+  return LCD_SUCCESS;
+}  // pioInit
+
+void lcd_pio_wait() {
+  // Wait for the PIO to stall (SM pull request finds no data in TX FIFO)
+  // This is used to detect when the SM is idle and hence ready for a jump instruction
+  lcd_pio->fdebug = pio_pull_stall_mask;
+  while (!(lcd_pio->fdebug & pio_pull_stall_mask));
+}  // lcd_pio_wait
+
+void set_rs(byte value) {
+  lcd_pio->sm[lcd_pio_tft_sm].instr = pio_encode_set(pio_pins, value);
+}
+
+void set_rst(byte value) {
+  digitalWrite(PIN_LCD_RST, value);
+}
+
+void lcd_send_dat_byte(uint8_t dat) {
+  // jump to pio_instr_jmp8
+  lcd_pio->sm[lcd_pio_tft_sm].instr = pio_instr_jmp8;
+
+  // write dat to SM FIFO
+  lcd_pio->txf[lcd_pio_tft_sm] = dat;
+
+  lcd_pio_wait();
+}  // lcd_send_dat_byte
 
 void lcd_send_cmd_byte(uint8_t cmd) {
+  // a DMA transfer (e.g. lcd_send_fill) may still be running
+  lcd_dma_wait();
+  lcd_pio_wait();
+
   set_rs(LOW);
 
-  // jump to pio_instr_jmp8
-  lcd_pio->sm[lcd_pio_tft_sm].instr = pio_instr_jmp8;
+  // jump to pio_instr_jmp8
+  lcd_pio->sm[lcd_pio_tft_sm].instr = pio_instr_jmp8;
+
+  // write cmd to SM FIFO
+  lcd_pio->txf[lcd_pio_tft_sm] = cmd;
+
+  lcd_pio_wait();
+
+  set_rs(HIGH);
+}  // lcd_send_cmd_byte
+
+// send a buffer of DATA bytes to the display
+lcd_error_t lcd_send_framebuffer(void* buf, uint32_t buffersize) {
+  if ((buffersize == 0) || (!lcd_dma_enabled))
+    return LCD_NOT_INIT;
+
+  // 8 bit data needs the palette lookup by the PIO
+  if (lcd_depth == 8 && lcd_pio_lut_sm < 0)
+    return LCD_NOT_SUPPORTED;
+
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  dma_channel_configure(lcd_dma_chan[0], &lcd_dma_config[0], &lcd_pio->txf[lcd_pio_data_sm], buf, buffersize, true);
+
+  return LCD_SUCCESS;
+}  // lcd_send_framebuffer
+
+/* ------------------------- command lists ------------------------- */
+void lcd_cmdlist_init(lcd_cmdlist_t* list, uint16_t* buf, uint16_t size) {
+  list->entries = buf;
+  list->len = 0;
+  list->size = size;
+}  // lcd_cmdlist_init
+
+void lcd_cmdlist_cmd(lcd_cmdlist_t* list, uint8_t cmd) {
+  // surplus entries are counted, so lcd_cmdlist_send can report the overflow
+  if (list->len < list->size)
+    list->entries[list->len] = cmd << LCD_CMDLIST_DAT_SHIFT;  // DC low
+
+  list->len++;
+}  // lcd_cmdlist_cmd
+
+void lcd_cmdlist_dat(lcd_cmdlist_t* list, uint8_t dat) {
+  if (list->len < list->size)
+    list->entries[list->len] = (dat << LCD_CMDLIST_DAT_SHIFT) | 1;  // DC high
+
+  list->len++;
+}  // lcd_cmdlist_dat
+
+// Sends the list and waits until the last byte has been written to the LCD
+// (the TFT state machine is switched to the command list program meanwhile).
+lcd_error_t lcd_cmdlist_send(lcd_cmdlist_t* list) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  if (list->len > list->size)
+    return LCD_NO_RAM;
+
+  if (list->len == 0)
+    return LCD_SUCCESS;
+
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  lcd_pio_cmdlist_setup();
+
+  // no interrupt: the list might be sent from within the DMA ISR
+  dma_channel_config c = dma_channel_get_default_config(lcd_dma_chan[0]);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_dreq(&c, pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
+  channel_config_set_irq_quiet(&c, true);
+
+  dma_channel_configure(lcd_dma_chan[0], &c, &lcd_pio->txf[lcd_pio_tft_sm], list->entries, list->len, true);
+
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  lcd_pio_tft_setup(lcd_pio_ds_active);
+  set_rs(HIGH);
+
+  return LCD_SUCCESS;
+}  // lcd_cmdlist_send
+
+// sends the same (16 bit) color to the LCD over and over again
+lcd_error_t lcd_send_fill(uint16_t color, uint32_t pixels) {
+  if ((pixels == 0) || (!lcd_dma_enabled))
+    return LCD_NOT_INIT;
+
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  lcd_fill_color = color;
+  lcd_screen_changed();
+
+  dma_channel_config c = dma_channel_get_default_config(lcd_dma_chan[0]);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_read_increment(&c, false);
+  channel_config_set_dreq(&c, pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
+  channel_config_set_bswap(&c, LCD_DMA_BSWAP);
+
+  // the doublescan program sends every pixel twice
+  if (lcd_pio_ds_active)
+    pixels = (pixels + 1) / 2;
+
+#ifdef LCD_BUS_RGB444
+  // pixels are sent in pairs (the surplus pixel wraps around in the window)
+  pixels = (pixels + 1) & ~1;
+#endif
+
+  dma_channel_configure(lcd_dma_chan[0], &c, &lcd_pio->txf[lcd_pio_tft_sm], &lcd_fill_color, pixels, true);
+
+  return LCD_SUCCESS;
+}  // lcd_send_fill
+
+lcd_error_t lcd_fill_screen(uint16_t color) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  // a frame might be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+  lcd_wait_ready();
+
+  lcd_set_window(0, 0, LCD_PHYS_WIDTH - 1, LCD_PHYS_HEIGHT - 1);
+  lcd_window_full = true;
+
+  return lcd_send_fill(color, LCD_PHYS_WIDTH * LCD_PHYS_HEIGHT);
+}  // lcd_fill_screen
+
+/* ------------------------- mode switching ------------------------ */
+// Claims or releases everything the given mode (does not) need. The bus
+// must be idle.
+lcd_error_t lcd_apply_mode(uint8_t depth, lcd_fitter_t fitter) {
+  bool core1 = lcd_core1_mode(depth, fitter);
+
+  // palette lookup (by the PIO unless core1 converts the lines)
+  if (depth == 8 && !core1) {
+    if (lcd_pio_lut_enable() != LCD_SUCCESS)
+      return LCD_PIO_ERR;
+
+    if (lcd_dma_lut_enable() != LCD_SUCCESS)
+      return LCD_DMA_ERR;
+  } else {
+    lcd_dma_lut_disable();
+    lcd_pio_lut_disable();
+  }
+
+  // the PIO doubles the pixels horizontally in nearest neighbor mode
+  if ((fitter == LCD_FITTER_NEAREST) != lcd_pio_ds_active)
+    lcd_pio_tft_setup(fitter == LCD_FITTER_NEAREST);
+
+  // row chains
+  bool rows = fitter != LCD_FITTER_NONE || core1;
+
+  if (rows && lcd_dma_ctrl_chan < 0) {
+    lcd_dma_ctrl_chan = dma_claim_unused_channel(false);
+
+    if (lcd_dma_ctrl_chan < 0)
+      return LCD_DMA_ERR;
+  } else if (!rows && lcd_dma_ctrl_chan >= 0) {
+    dma_channel_unclaim(lcd_dma_ctrl_chan);
+    lcd_dma_ctrl_chan = -1;
+  }
+
+  // core1 and the line buffers are only claimed while core1 prepares the lines
+  if (!core1 && lcd_line_buf != NULL) {
+    multicore_reset_core1();
+    free(lcd_line_buf);
+    lcd_line_buf = NULL;
+  }
+
+  lcd_depth = depth;
+  lcd_fitter = fitter;
+  lcd_screen_changed();
+  if (fitter == LCD_FITTER_SCALED) {
+    lcd_scale = 1;  // (not an integer, the scaler keeps its own geometry)
+    lcd_scr_width = LCD_PHYS_WIDTH * lcd_sc_den / lcd_sc_num;
+    lcd_scr_height = LCD_PHYS_HEIGHT * lcd_sc_den / lcd_sc_num;
+  } else {
+    lcd_scale = (fitter == LCD_FITTER_NONE) ? 1 : 2;
+    lcd_scr_width = LCD_PHYS_WIDTH / lcd_scale;
+    lcd_scr_height = LCD_PHYS_HEIGHT / lcd_scale;
+  }
+  lcd_pio_data_sm = (lcd_pio_lut_sm >= 0) ? lcd_pio_lut_sm : lcd_pio_tft_sm;
+  lcd_row_table_buf = NULL;
+
+  // the lines of the palette changes refer to the previous mode
+  lcd_pal_num_splits[0] = lcd_pal_num_splits[1] = 0;
+  lcd_pal_splits_pending = false;
+
+  if (core1 && lcd_line_buf == NULL) {
+    lcd_line_buf = (uint16_t*) malloc((LCD_LINE_BUFS + 1) * LCD_PHYS_WIDTH * 2);
+
+    if (lcd_line_buf == NULL)
+      return LCD_NO_RAM;
+
+    multicore_launch_core1(lcd_lin_core1);
+  }
+
+  if (fitter == LCD_FITTER_LINEAR) {
+    // the ring of line buffers is listed over and over
+    for (uint16_t j = 0; j < lcd_scr_height * 2; j++)
+      lcd_row_table[j] = lcd_lin_line(j);
+    lcd_lin_rows = lcd_scr_height * 2;
+    lcd_row_table[lcd_lin_rows] = NULL;
+  } else if (fitter == LCD_FITTER_SCALED) {
+    // each physical line shows the ring slot of its framebuffer line
+    for (uint16_t j = 0; j < LCD_PHYS_HEIGHT; j++)
+      lcd_row_table[j] = lcd_lin_line(j * lcd_scr_height / LCD_PHYS_HEIGHT);
+    lcd_lin_rows = LCD_PHYS_HEIGHT;
+    lcd_row_table[lcd_lin_rows] = NULL;
+
+    // framebuffer column of each physical column (in the scratch line)
+    uint16_t* xmap = &lcd_line_buf[LCD_LINE_BUFS * LCD_PHYS_WIDTH];
+    for (uint16_t x = 0; x < LCD_PHYS_WIDTH; x++)
+      xmap[x] = x * lcd_scr_width / LCD_PHYS_WIDTH;
+  } else if (core1) {
+    // (palette expansion, listed by the first frame)
+    lcd_lin_rows = 0;
+  }
+
+  lcd_dma_setup_configs();
+
+  return LCD_SUCCESS;
+}  // lcd_apply_mode
+
+lcd_error_t lcd_set_mode(uint8_t depth, lcd_fitter_t fitter) {
+  if (!lcd_init_complete)
+    return LCD_NOT_INIT;
+
+  if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  // packed lines are converted by core1 (without interpolation or scaling)
+  if (depth < 8 && fitter != LCD_FITTER_NONE && fitter != LCD_FITTER_NEAREST)
+    return LCD_NOT_SUPPORTED;
+
+#ifdef LCD_BUS_RGB444
+  // pixel doubling by the PIO needs the doublescan program
+  if (fitter == LCD_FITTER_NEAREST)
+    return LCD_NOT_SUPPORTED;
+#endif
+
+  // (the scaler is always set up again, its factor may have changed)
+  if (depth == lcd_depth && fitter == lcd_fitter && fitter != LCD_FITTER_SCALED)
+    return LCD_SUCCESS;
+
+  // nothing must be on the bus while the hardware is reconfigured
+  lcd_swap_detach();
+  lcd_wait_ready();
+  lcd_pio_wait();
+
+  lcd_error_t err = lcd_apply_mode(depth, fitter);
+
+  if (err != LCD_SUCCESS)
+    return err;
+
+  // restart the controller's write pointer at the upper left corner
+  lcd_reset_window();
+
+  return LCD_SUCCESS;
+}  // lcd_set_mode
+
+// Scales the framebuffer by num / den (e.g. 3 / 2 turns 320x240 into
+// 213x160), any factor from above 1 up to 8 is accepted.
+lcd_error_t lcd_set_mode_scaled(uint8_t depth, uint8_t num, uint8_t den) {
+  if (den == 0 || num <= den || num > den * 8)
+    return LCD_INVALID_PARAM;
+
+  // Only read by lcd_apply_mode (after the bus has become idle). If the mode
+  // is refused, the factor of the current mode is kept.
+  uint8_t prev_num = lcd_sc_num;
+  uint8_t prev_den = lcd_sc_den;
+
+  lcd_sc_num = num;
+  lcd_sc_den = den;
+
+  lcd_error_t err = lcd_set_mode(depth, LCD_FITTER_SCALED);
+
+  if (err != LCD_SUCCESS) {
+    lcd_sc_num = prev_num;
+    lcd_sc_den = prev_den;
+  }
+
+  return err;
+}  // lcd_set_mode_scaled
+
+/* ----------------------- partial updates ----------------------- */
+void lcd_set_window(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+  // the window must not be changed while data is still being transmitted
+  lcd_dma_wait();
+  lcd_pio_wait();
+
+  lcd_set_addr(x1, y1, x2, y2);
+
+  lcd_window_full = false;
+}  // lcd_set_window
+
+void lcd_reset_window() {
+  lcd_set_window(0, 0, LCD_PHYS_WIDTH - 1, LCD_PHYS_HEIGHT - 1);
+  lcd_window_full = true;
+}  // lcd_reset_window
+
+uint32_t lcd_rect_cost(lcd_rect_t* r) {
+  return (r->x2 - r->x1 + 1) * (r->y2 - r->y1 + 1) + LCD_RECT_OVERHEAD;
+}  // lcd_rect_cost
+
+void lcd_rect_union(lcd_rect_t* dst, lcd_rect_t* src) {
+  if (src->x1 < dst->x1) dst->x1 = src->x1;
+  if (src->y1 < dst->y1) dst->y1 = src->y1;
+  if (src->x2 > dst->x2) dst->x2 = src->x2;
+  if (src->y2 > dst->y2) dst->y2 = src->y2;
+}  // lcd_rect_union
+
+// Clips the rectangles to the screen, drops empty ones and merges rectangles
+// whenever sending the bounding box is cheaper than sending them one by one.
+// Returns the number of remaining rectangles.
+uint8_t lcd_merge_rects(lcd_rect_t* rects, uint8_t num_rects, lcd_rect_t* dst) {
+  uint8_t num = 0;
+
+  for (uint8_t h = 0; h < num_rects; h++) {
+    lcd_rect_t r = rects[h];
+
+    if (r.x1 > r.x2) swap_coords(r.x1, r.x2);
+    if (r.y1 > r.y2) swap_coords(r.y1, r.y2);
+
+    if (r.x2 < 0 || r.y2 < 0 || r.x1 >= lcd_scr_width || r.y1 >= lcd_scr_height)
+      continue;
+
+    if (r.x1 < 0) r.x1 = 0;
+    if (r.y1 < 0) r.y1 = 0;
+    if (r.x2 >= lcd_scr_width) r.x2 = lcd_scr_width - 1;
+    if (r.y2 >= lcd_scr_height) r.y2 = lcd_scr_height - 1;
+
+    if (num < LCD_MAX_RECTS) {
+      dst[num++] = r;
+      continue;
+    }
+
+    // out of slots: add to the rectangle which grows the least
+    uint8_t best = 0;
+    uint32_t best_cost = UINT32_MAX;
+
+    for (uint8_t i = 0; i < num; i++) {
+      lcd_rect_t u = dst[i];
+      lcd_rect_union(&u, &r);
+      uint32_t cost = lcd_rect_cost(&u) - lcd_rect_cost(&dst[i]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = i;
+      }
+    }
+
+    lcd_rect_union(&dst[best], &r);
+  }
+
+  bool merged = true;
+
+  while (merged) {
+    merged = false;
+
+    for (uint8_t i = 0; i < num; i++)
+      for (uint8_t j = i + 1; j < num; j++) {
+        lcd_rect_t u = dst[i];
+        lcd_rect_union(&u, &dst[j]);
+
+        if (lcd_rect_cost(&u) > lcd_rect_cost(&dst[i]) + lcd_rect_cost(&dst[j]))
+          continue;
+
+        dst[i] = u;
+        dst[j] = dst[--num];
+        merged = true;
+        j = i;  // dst[i] has grown, so check all others again
+      }
+  }
+
+  return num;
+}  // lcd_merge_rects
+
+// sends the whole frame of a buffer whose lines are stride pixels apart
+lcd_error_t lcd_show_stride(void* data, uint16_t stride) {
+  if (stride == lcd_scr_width)
+    return lcd_show_data(data);
+
+  return lcd_show_view(data, lcd_line_bytes(stride), lcd_scr_width, lcd_scr_height, 0, 0);
+}  // lcd_show_stride
+
+// buf_stride: pixels from one line of the buffer to the next
+lcd_error_t lcd_show_rects(void* data, uint16_t buf_stride, lcd_rect_t* rects, uint8_t num_rects) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  // core1 prepares whole frames only
+  if (lcd_core1_lines())
+    return lcd_show_stride(data, buf_stride);
+
+  lcd_rect_t dirty[LCD_MAX_RECTS];
+  uint8_t num = lcd_merge_rects(rects, num_rects, dirty);
+
+  uint32_t dirty_pixels = 0;
+  for (uint8_t h = 0; h < num; h++)
+    dirty_pixels += lcd_rect_cost(&dirty[h]);
+
+  // partial update would not be worth the effort
+  if (dirty_pixels >= lcd_scr_width * lcd_scr_height)
+    return lcd_show_stride(data, buf_stride);
+
+  // a frame of a swap chain may still be pending (it would be started by
+  // the TE interrupt between the rectangles)
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+
+  // wait for the previous frame before changing the window
+  lcd_wait_ready();
+
+  lcd_screen_changed();
+
+  // palette changes per line do not apply
+  if (lcd_pio_lut_sm >= 0)
+    lcd_pal_select(lcd_palette[lcd_pal_front]);
+
+  uint8_t bytes_pp = lcd_depth / 8;
+
+  for (uint8_t h = 0; h < num; h++) {
+    lcd_rect_t* r = &dirty[h];
+
+#ifdef LCD_BUS_RGB444
+    // pixels are sent in pairs, so every line must have an even length
+    r->x1 &= ~1;
+    r->x2 |= 1;
+#endif
+
+    uint16_t rect_width = r->x2 - r->x1 + 1;
+
+    lcd_set_window(r->x1 * lcd_scale, r->y1 * lcd_scale,
+                   (r->x2 + 1) * lcd_scale - 1, (r->y2 + 1) * lcd_scale - 1);
+
+    // full width rectangles are contiguous in memory
+    if (rect_width == buf_stride && lcd_fitter != LCD_FITTER_NEAREST) {
+      lcd_send_framebuffer((uint8_t*) data + r->y1 * buf_stride * bytes_pp, rect_width * (r->y2 - r->y1 + 1));
+      continue;
+    }
+
+    for (coord_t y = r->y1; y <= r->y2; y++)
+      for (uint8_t i = 0; i < lcd_scale; i++)  // the PIO only doubles horizontally
+        lcd_send_framebuffer((uint8_t*) data + (y * buf_stride + r->x1) * bytes_pp, rect_width);
+  }
+
+  return LCD_SUCCESS;
+}  // lcd_show_rects
+
+lcd_error_t lcd_show_framebuffer_rects(gbuffer8_t buf, lcd_rect_t* rects, uint8_t num_rects) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  return lcd_show_rects((void*) buf.data, gbuf_get_stride(buf), rects, num_rects);
+}  // lcd_show_framebuffer_rects
+
+lcd_error_t lcd_show_framebuffer_rects(gbuffer16_t buf, lcd_rect_t* rects, uint8_t num_rects) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  return lcd_show_rects((void*) buf.data, gbuf_get_stride(buf), rects, num_rects);
+}  // lcd_show_framebuffer_rects
+
+/* ----------------------- interlaced fields ----------------------- */
+// Makes the LUT use the palette of framebuffer line y when the lines of a
+// frame are sent top down in several transfers (b is the band of the
+// previous line). Returns the band of line y.
+uint8_t lcd_pal_seek(coord_t y, uint8_t b) {
+  if (b + 1 >= lcd_num_bands || y < lcd_band_line(b + 1))
+    return b;
+
+  // the buffer of the current palette may be reused when skipping bands
+  lcd_dma_wait();
+  lcd_pio_lut_drain();
+
+  const color_palette_t* pal = NULL;
+  while (b + 1 < lcd_num_bands && y >= lcd_band_line(b + 1))
+    pal = lcd_pal_prepare(lcd_pal_splits[lcd_pal_splits_cur], ++b);
+
+  lcd_pal_select(pal);
+
+  return b;
+}  // lcd_pal_seek
+
+// Sends every other line of the frame, the even and the odd lines in turns.
+// Every line needs its own window, hence the field is sent synchronously.
+lcd_error_t lcd_show_field(void* data) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  // core1 prepares whole frames only
+  if (lcd_core1_lines())
+    return lcd_show_data(data);
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+  lcd_wait_ready();
+
+  lcd_screen_changed();
+
+  lcd_pal_frame_start();
+
+  // palette changes are applied while walking down the lines (8 bit only)
+  lcd_frm_width = lcd_scr_width;
+  lcd_frm_height = lcd_scr_height;
+  lcd_num_bands = (lcd_depth == 8) ? lcd_pal_num_splits[lcd_pal_splits_cur] + 1 : 1;
+  uint8_t b = 0;
+
+  uint32_t line_size = lcd_scr_width * (lcd_depth / 8);
+
+  for (coord_t y = lcd_field; y < lcd_scr_height; y += 2) {
+    lcd_set_window(0, y * lcd_scale, LCD_PHYS_WIDTH - 1, (y + 1) * lcd_scale - 1);
+    b = lcd_pal_seek(y, b);
+
+    for (uint8_t i = 0; i < lcd_scale; i++)  // the PIO only doubles horizontally
+      lcd_send_framebuffer((uint8_t*) data + y * line_size, lcd_scr_width);
+  }
+
+  lcd_field ^= 1;
+
+  return LCD_SUCCESS;
+}  // lcd_show_field
+
+lcd_error_t lcd_show_framebuffer_interlaced(gbuffer8_t buf) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  // the lines need to follow each other
+  if (gbuf_get_stride(buf) != gbuf_get_width(buf))
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_field((void*) buf.data);
+}  // lcd_show_framebuffer_interlaced
+
+lcd_error_t lcd_show_framebuffer_interlaced(gbuffer16_t buf) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  // the lines need to follow each other
+  if (gbuf_get_stride(buf) != gbuf_get_width(buf))
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_field((void*) buf.data);
+}  // lcd_show_framebuffer_interlaced
+
+/* ------------------ change detection (checksums) ----------------- */
+// the checksum channel is claimed on first use
+lcd_error_t lcd_dma_crc_claim() {
+  if (lcd_dma_crc_chan >= 0)
+    return LCD_SUCCESS;
+
+  lcd_dma_crc_chan = dma_claim_unused_channel(false);
+
+  if (lcd_dma_crc_chan < 0)
+    return LCD_DMA_ERR;
+
+  return LCD_SUCCESS;
+}  // lcd_dma_crc_claim
+
+// Computes the checksum of a whole frame (any color depth). Returns false if
+// no DMA channel is available.
+bool lcd_frame_crc(void* data, uint32_t* crc) {
+  uint32_t size = lcd_line_bytes(lcd_scr_width) * lcd_scr_height;
+
+  if (lcd_dma_crc_claim() != LCD_SUCCESS)
+    return false;
+
+  // packed frames may end within a word
+  bool words = (size % 4 == 0);
 
-  // write cmd to SM FIFO
-  lcd_pio->txf[lcd_pio_tft_sm] = cmd;
+  dma_channel_config c = dma_channel_get_default_config(lcd_dma_crc_chan);
+  channel_config_set_transfer_data_size(&c, words ? DMA_SIZE_32 : DMA_SIZE_8);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_sniff_enable(&c, true);
 
-  lcd_pio_wait();
+  dma_sniffer_enable(lcd_dma_crc_chan, 0x0, true);  // CRC32
+  dma_sniffer_set_data_accumulator(0xFFFFFFFF);
 
-  set_rs(HIGH);
-}  // lcd_send_cmd_byte
+  dma_channel_configure(lcd_dma_crc_chan, &c, &lcd_dma_crc_dummy, data, words ? size / 4 : size, true);
+  dma_channel_wait_for_finish_blocking(lcd_dma_crc_chan);
 
-uint32_t testy;
+  *crc = dma_sniffer_get_data_accumulator();
 
-// send a buffer of DATA bytes to the display
-lcd_error_t lcd_send_framebuffer(void* buf, uint32_t buffersize) {
-  if ((buffersize == 0) || (!lcd_dma_enabled))
+  dma_sniffer_disable();
+
+  return true;
+}  // lcd_frame_crc
+
+// Computes the checksums of all bands of lines by DMA (the sniffer
+// calculates a CRC32 of the data passing by). Returns the number of bands.
+uint8_t lcd_crc_bands(void* data, uint32_t* crc) {
+  uint32_t band_size = LCD_CRC_BAND_HEIGHT * lcd_scr_width * (lcd_depth / 8);
+  uint32_t frame_size = lcd_scr_height * lcd_scr_width * (lcd_depth / 8);
+  uint8_t num = 0;
+
+  dma_channel_config c = dma_channel_get_default_config(lcd_dma_crc_chan);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_sniff_enable(&c, true);
+
+  dma_sniffer_enable(lcd_dma_crc_chan, 0x0, true);  // CRC32
+
+  for (uint32_t ofs = 0; ofs < frame_size; ofs += band_size) {
+    uint32_t size = (frame_size - ofs < band_size) ? frame_size - ofs : band_size;
+
+    dma_sniffer_set_data_accumulator(0xFFFFFFFF);
+    dma_channel_configure(lcd_dma_crc_chan, &c, &lcd_dma_crc_dummy, (uint8_t*) data + ofs, size / 4, true);
+    dma_channel_wait_for_finish_blocking(lcd_dma_crc_chan);
+
+    crc[num++] = dma_sniffer_get_data_accumulator();
+  }
+
+  dma_sniffer_disable();
+
+  return num;
+}  // lcd_crc_bands
+
+// sends framebuffer lines y1 up to (excluding) y2 into the current window
+void lcd_send_lines(void* data, coord_t y1, coord_t y2) {
+  uint32_t line_size = lcd_scr_width * (lcd_depth / 8);
+
+  if (lcd_fitter == LCD_FITTER_NONE) {
+    lcd_send_framebuffer((uint8_t*) data + y1 * line_size, (y2 - y1) * lcd_scr_width);
+    return;
+  }
+
+  for (coord_t y = y1; y < y2; y++)
+    for (uint8_t i = 0; i < lcd_scale; i++)  // the PIO only doubles horizontally
+      lcd_send_framebuffer((uint8_t*) data + y * line_size, lcd_scr_width);
+}  // lcd_send_lines
+
+// Sends only the bands of lines whose checksum has changed since the last
+// call. The changed bands are sent synchronously.
+lcd_error_t lcd_show_changed(void* data) {
+  if (!lcd_dma_enabled)
     return LCD_NOT_INIT;
 
+  // core1 prepares whole frames only
+  if (lcd_core1_lines())
+    return lcd_show_data(data);
+
+  if (lcd_dma_crc_claim() != LCD_SUCCESS)
+    return LCD_DMA_ERR;
+
+  uint32_t crc[sizeof(lcd_crc) / sizeof(lcd_crc[0])];
+  uint8_t num = lcd_crc_bands(data, crc);
+
+  // a new palette changes every line (the checksums only cover the indices)
+  if (!lcd_crc_valid || lcd_pal_flip_pending || lcd_pal_splits_pending) {
+    lcd_error_t err = lcd_show_data(data);
+
+    memcpy(lcd_crc, crc, num * sizeof(crc[0]));
+    lcd_crc_valid = (err == LCD_SUCCESS);
+
+    return err;
+  }
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+  lcd_wait_ready();
+
+  lcd_pal_frame_start();
+
+  // palette changes are applied while walking down the lines (8 bit only)
+  lcd_frm_width = lcd_scr_width;
+  lcd_frm_height = lcd_scr_height;
+  lcd_num_bands = (lcd_depth == 8) ? lcd_pal_num_splits[lcd_pal_splits_cur] + 1 : 1;
+  uint8_t b = 0;
+
+  for (uint8_t h = 0; h < num; h++) {
+    if (crc[h] == lcd_crc[h])
+      continue;
+
+    // adjacent changed bands are sent into a single window
+    uint8_t last = h;
+    while (last + 1 < num && crc[last + 1] != lcd_crc[last + 1])
+      last++;
+
+    coord_t y = h * LCD_CRC_BAND_HEIGHT;
+    coord_t y_end = (last + 1) * LCD_CRC_BAND_HEIGHT;
+
+    if (y_end > lcd_scr_height)
+      y_end = lcd_scr_height;
+
+    lcd_set_window(0, y * lcd_scale, LCD_PHYS_WIDTH - 1, y_end * lcd_scale - 1);
+
+    while (y < y_end) {
+      b = lcd_pal_seek(y, b);
+
+      // lines up to the next palette change
+      coord_t y_stop = lcd_band_line(b + 1);
+
+      if (y_stop > y_end)
+        y_stop = y_end;
+
+      lcd_send_lines(data, y, y_stop);
+      y = y_stop;
+    }
+
+    h = last;
+  }
+
+  memcpy(lcd_crc, crc, num * sizeof(crc[0]));
+  lcd_crc_valid = true;
+
+  // the bands sent are not covered by the checksum of a static screen
+  lcd_static_valid = false;
+
+  return LCD_SUCCESS;
+}  // lcd_show_changed
+
+lcd_error_t lcd_show_framebuffer_changed(gbuffer8_t buf) {
+  if (lcd_depth != 8)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  // the lines need to follow each other
+  if (gbuf_get_stride(buf) != gbuf_get_width(buf))
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_changed((void*) buf.data);
+}  // lcd_show_framebuffer_changed
+
+lcd_error_t lcd_show_framebuffer_changed(gbuffer16_t buf) {
+  if (lcd_depth != 16)
+    return LCD_NOT_SUPPORTED;
+
+  if (!lcd_is_screen_size(gbuf_get_width(buf), gbuf_get_height(buf)))
+    return LCD_INVALID_PARAM;
+
+  // the lines need to follow each other
+  if (gbuf_get_stride(buf) != gbuf_get_width(buf))
+    return LCD_NOT_SUPPORTED;
+
+  return lcd_show_changed((void*) buf.data);
+}  // lcd_show_framebuffer_changed
+
+/* ------------------------ direct drawing ------------------------ */
+// Waits until the bus is free for drawing straight to the panel. Pixel data
+// needs the plain program (the doublescan program sends every pixel twice).
+// Without pixels, commands follow which end the memory write, so the next
+// frame has to set the window again.
+void lcd_direct_begin(bool pixels) {
+  // a frame might be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+  lcd_wait_ready();
+
+  if (!pixels)
+    lcd_window_full = false;
+
+  if (pixels && lcd_pio_ds_active) {
+    lcd_pio_wait();
+    lcd_pio_tft_setup(false);
+  }
+}  // lcd_direct_begin
+
+// switches back to the doublescan program once the pixels have been sent
+void lcd_direct_end() {
+  if (lcd_fitter == LCD_FITTER_NEAREST && !lcd_pio_ds_active) {
+    lcd_dma_wait();
+    lcd_pio_wait();
+    lcd_pio_tft_setup(true);
+  }
+}  // lcd_direct_end
+
+// sends RGB565 pixels into the current window (whatever the screen mode)
+void lcd_send_pixels(const uint16_t* data, uint32_t pixels) {
   lcd_dma_wait();
   lcd_pio_wait();
 
-#if LCD_COLORDEPTH == 8
-  dma_channel_configure(lcd_dma_chan[0], &lcd_dma_config[0], &lcd_pio->txf[lcd_pio_lut_sm], buf, buffersize, true);
-#elif LCD_COLORDEPTH == 16
-  dma_channel_configure(lcd_dma_chan[0], &lcd_dma_config[0], &lcd_pio->txf[lcd_pio_tft_sm], buf, buffersize, true);
+  lcd_screen_changed();
+
+  dma_channel_config c = dma_channel_get_default_config(lcd_dma_chan[0]);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+  channel_config_set_dreq(&c, pio_get_dreq(lcd_pio, lcd_pio_tft_sm, true));
+  channel_config_set_bswap(&c, LCD_DMA_BSWAP);
+
+  dma_channel_configure(lcd_dma_chan[0], &c, &lcd_pio->txf[lcd_pio_tft_sm], data, pixels, true);
+}  // lcd_send_pixels
+
+// Completes the last pair of pixels of a window holding an odd number of
+// pixels (RGB444 only). The surplus pixel wraps around to the start of the
+// window, so it repeats the first one.
+void lcd_pad_window(uint32_t pixels, uint16_t first) {
+#ifdef LCD_BUS_RGB444
+  if (pixels & 1) {
+    lcd_dma_wait();
+    lcd_fill_color = first;
+    lcd_send_pixels(&lcd_fill_color, 1);
+  }
+#else
+  (void) pixels;
+  (void) first;
 #endif
+}  // lcd_pad_window
+
+// clips a rectangle to the panel, returns false if nothing is left
+bool lcd_clip_rect(coord_t* x1, coord_t* y1, coord_t* x2, coord_t* y2) {
+  if (*x1 > *x2)
+    swap_coords(*x1, *x2);
+
+  if (*y1 > *y2)
+    swap_coords(*y1, *y2);
+
+  if (*x2 < 0 || *y2 < 0 || *x1 >= LCD_PHYS_WIDTH || *y1 >= LCD_PHYS_HEIGHT)
+    return false;
+
+  if (*x1 < 0)
+    *x1 = 0;
+
+  if (*y1 < 0)
+    *y1 = 0;
+
+  if (*x2 >= LCD_PHYS_WIDTH)
+    *x2 = LCD_PHYS_WIDTH - 1;
+
+  if (*y2 >= LCD_PHYS_HEIGHT)
+    *y2 = LCD_PHYS_HEIGHT - 1;
+
+  return true;
+}  // lcd_clip_rect
+
+// Fills a rectangle of the panel (physical coordinates, RGB565) without a
+// framebuffer. The DMA repeats the color, the function returns immediately.
+lcd_error_t lcd_draw_rect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint16_t color) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  if (!lcd_clip_rect(&x1, &y1, &x2, &y2))
+    return LCD_SUCCESS;
+
+  lcd_direct_begin(false);
+
+  lcd_set_window(x1, y1, x2, y2);
+
+  return lcd_send_fill(color, (x2 - x1 + 1) * (y2 - y1 + 1));
+}  // lcd_draw_rect_fill
+
+lcd_error_t lcd_draw_hline(coord_t x1, coord_t x2, coord_t y, uint16_t color) {
+  return lcd_draw_rect_fill(x1, y, x2, y, color);
+}  // lcd_draw_hline
+
+lcd_error_t lcd_draw_vline(coord_t x, coord_t y1, coord_t y2, uint16_t color) {
+  return lcd_draw_rect_fill(x, y1, x, y2, color);
+}  // lcd_draw_vline
+
+lcd_error_t lcd_draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint16_t color) {
+  lcd_error_t err = lcd_draw_hline(x1, x2, y1, color);
+
+  if (err != LCD_SUCCESS)
+    return err;
+
+  lcd_draw_hline(x1, x2, y2, color);
+  lcd_draw_vline(x1, y1, y2, color);
+  return lcd_draw_vline(x2, y1, y2, color);
+}  // lcd_draw_rect
+
+// Copies a buffer to the panel at (x, y) (physical coordinates, opaque). The
+// visible part is sent into a single window. The buffer needs to remain
+// valid until the transfer is done (see lcd_wait_ready).
+lcd_error_t lcd_draw_buf(coord_t x, coord_t y, gbuffer16_t src) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  coord_t x1 = x, y1 = y;
+  coord_t x2 = x + gbuf_get_width(src) - 1, y2 = y + gbuf_get_height(src) - 1;
+
+  if (gbuf_get_width(src) == 0 || gbuf_get_height(src) == 0 || !lcd_clip_rect(&x1, &y1, &x2, &y2))
+    return LCD_SUCCESS;
+
+  uint16_t width = x2 - x1 + 1;
+  uint32_t pixels = width * (y2 - y1 + 1);
+  const uint16_t* first = &src.data[(y1 - y) * gbuf_get_stride(src) + (x1 - x)];
+
+  lcd_direct_begin(true);
+  lcd_set_window(x1, y1, x2, y2);
+
+  if (width == gbuf_get_stride(src)) {
+    lcd_send_pixels(first, pixels);
+  } else {
+    // clipped horizontally or a view: line by line
+    for (coord_t h = y1; h <= y2; h++)
+      lcd_send_pixels(first + (h - y1) * gbuf_get_stride(src), width);
+  }
+
+  lcd_pad_window(pixels, *first);
+  lcd_direct_end();
 
   return LCD_SUCCESS;
-}  // lcd_send_framebuffer
+}  // lcd_draw_buf
+
+// Same for 8 bit buffers: the lines are converted using the front palette
+// in slices of LCD_DRAW_SLICE pixels (alternating between two slice
+// buffers). Returns when the buffer has been sent.
+lcd_error_t lcd_draw_buf(coord_t x, coord_t y, gbuffer8_t src) {
+  if (!lcd_dma_enabled)
+    return LCD_NOT_INIT;
+
+  coord_t x1 = x, y1 = y;
+  coord_t x2 = x + gbuf_get_width(src) - 1, y2 = y + gbuf_get_height(src) - 1;
+
+  if (gbuf_get_width(src) == 0 || gbuf_get_height(src) == 0 || !lcd_clip_rect(&x1, &y1, &x2, &y2))
+    return LCD_SUCCESS;
+
+  uint16_t width = x2 - x1 + 1;
+  const color_palette_t* pal = lcd_palette[lcd_pal_front];
+  uint16_t first = pal[src.data[(y1 - y) * gbuf_get_stride(src) + (x1 - x)]];
+  uint16_t slice[2][LCD_DRAW_SLICE];
+  uint8_t cur = 0;
+
+  lcd_direct_begin(true);
+  lcd_set_window(x1, y1, x2, y2);
+
+  for (coord_t h = y1; h <= y2; h++) {
+    const uint8_t* src8 = &src.data[(h - y) * gbuf_get_stride(src) + (x1 - x)];
+
+    // the window is filled pixel by pixel, so a line may be split anywhere
+    for (uint16_t i = 0; i < width; i += LCD_DRAW_SLICE) {
+      uint16_t len = width - i < LCD_DRAW_SLICE ? width - i : LCD_DRAW_SLICE;
+      uint16_t* dst = slice[cur];
+
+      // (the slice buffer has been sent by the transfer before the previous one)
+      for (uint16_t j = 0; j < len; j++)
+        dst[j] = pal[src8[i + j]];
+
+      lcd_send_pixels(dst, len);
+      cur ^= 1;
+    }
+  }
+
+  lcd_pad_window(width * (y2 - y1 + 1), first);
+  lcd_direct_end();
+
+  // the slice buffers are on the stack
+  lcd_dma_wait();
+
+  return LCD_SUCCESS;
+}  // lcd_draw_buf
+
+/* ---------------------- vertical scrolling ---------------------- */
+// The controller scrolls along its own lines (PHYS_SCREEN_HEIGHT of them),
+// which are the columns of the screen in the landscape rotations.
+lcd_error_t lcd_scroll_init(uint16_t top, uint16_t bottom) {
+  if (top + bottom >= PHYS_SCREEN_HEIGHT)
+    return LCD_INVALID_PARAM;
+
+  lcd_scroll_top = top;
+  lcd_scroll_height = PHYS_SCREEN_HEIGHT - top - bottom;
+  lcd_scroll_ofs = 0;
+
+  lcd_direct_begin(false);
+  lcd_set_scroll_area(top, lcd_scroll_height, bottom);
+  lcd_set_scroll_start(top);
+
+  return LCD_SUCCESS;
+}  // lcd_scroll_init
+
+// shows the scrolling area starting at its line ofs (wrapping around)
+lcd_error_t lcd_scroll_to(uint16_t ofs) {
+  lcd_scroll_ofs = ofs % lcd_scroll_height;
+
+  lcd_direct_begin(false);
+  lcd_set_scroll_start(lcd_scroll_top + lcd_scroll_ofs);
+
+  return LCD_SUCCESS;
+}  // lcd_scroll_to
+
+// line of the controller shown at the visible line y of the scrolling area
+// (where the newly exposed content has to be drawn)
+uint16_t lcd_scroll_line(uint16_t y) {
+  return lcd_scroll_top + (lcd_scroll_ofs + y) % lcd_scroll_height;
+}  // lcd_scroll_line
+
+/* ------------------------- static screens ------------------------ */
+// Shows only the lines first to last of the controller (partial display,
+// the other lines are blanked) and optionally switches to 8 colors (idle
+// mode). Frames equal to the previous one are no longer sent.
+lcd_error_t lcd_static_begin(uint16_t first, uint16_t last, bool idle) {
+  if (!lcd_init_complete)
+    return LCD_NOT_INIT;
+
+  if (first > last || last >= PHYS_SCREEN_HEIGHT)
+    return LCD_INVALID_PARAM;
+
+  lcd_direct_begin(false);
+
+  // partial mode would only add a mode switch if all lines are shown
+  if (first > 0 || last < PHYS_SCREEN_HEIGHT - 1)
+    lcd_set_partial_area(first, last);
+  else
+    lcd_set_normal_mode();
+
+  lcd_set_idle(idle);
+
+  // the first frame is always sent
+  lcd_static_active = true;
+  lcd_static_valid = false;
+
+  return LCD_SUCCESS;
+}  // lcd_static_begin
+
+lcd_error_t lcd_static_end() {
+  if (!lcd_static_active)
+    return LCD_SUCCESS;
+
+  lcd_direct_begin(false);
+  lcd_set_idle(false);
+  lcd_set_normal_mode();
+
+  lcd_static_active = false;
+
+  return LCD_SUCCESS;
+}  // lcd_static_end
+
+bool lcd_static_is_active() {
+  return lcd_static_active;
+}  // lcd_static_is_active
+
+/* ------------------------ strip renderer ------------------------ */
+lcd_error_t lcd_strip_init() {
+  // the strips are of the compile time type gbuffer_t (and are sent as they
+  // are, without core1)
+  if (lcd_fitter != LCD_FITTER_NONE || lcd_depth != LCD_COLORDEPTH || lcd_core1_lines())
+    return LCD_NOT_SUPPORTED;
+
+  if (lcd_strip_allocated)
+    return LCD_SUCCESS;
+
+  for (int h = 0; h < 2; h++) {
+    if (gbuf_alloc(&lcd_strip_buf[h], lcd_scr_width, LCD_STRIP_HEIGHT) != BUF_SUCCESS) {
+      if (h > 0)
+        gbuf_free(lcd_strip_buf[0]);
+      return LCD_NO_RAM;
+    }
+  }
+
+  lcd_strip_allocated = true;
+
+  return LCD_SUCCESS;
+}  // lcd_strip_init
+
+void lcd_strip_free() {
+  if (!lcd_strip_allocated)
+    return;
+
+  // a strip may still be on the bus
+  lcd_dma_wait();
+
+  for (int h = 0; h < 2; h++)
+    gbuf_free(lcd_strip_buf[h]);
+
+  lcd_strip_allocated = false;
+}  // lcd_strip_free
+
+lcd_error_t lcd_show_strips(lcd_strip_cb_t render) {
+  if (!lcd_strip_allocated)
+    return LCD_NOT_INIT;
+
+  // the screen mode has been changed
+  if (lcd_fitter != LCD_FITTER_NONE || lcd_depth != LCD_COLORDEPTH || lcd_core1_lines())
+    return LCD_NOT_SUPPORTED;
+
+  // a frame of a swap chain may still be pending
+  while (lcd_swap_active != NULL && lcd_swap_active->queued >= 0)
+    lcd_wait_event();
+
+  lcd_wait_ready();
+
+  lcd_screen_changed();
+
+  // palette changes per line do not apply
+  if (lcd_pio_lut_sm >= 0)
+    lcd_pal_select(lcd_palette[lcd_pal_front]);
+
+  // the strips are streamed into the full window one after another
+  if (!lcd_window_full)
+    lcd_reset_window();
+
+  uint8_t cur = 0;
+
+  for (coord_t y = 0; y < lcd_scr_height; y += LCD_STRIP_HEIGHT) {
+    gbuffer_t strip = lcd_strip_buf[cur];
+
+    // the last strip might be cut off
+    if (lcd_scr_height - y < LCD_STRIP_HEIGHT)
+      strip.height = lcd_scr_height - y;
+
+    // Rendering takes place while the previous strip is being sent. The
+    // strip rendered into this buffer before has already been sent, since
+    // the previous strip could only be started after it.
+    render(strip, y);
+
+    // waits for the previous strip
+    lcd_send_framebuffer(strip.data, lcd_scr_width * strip.height);
+
+    cur ^= 1;
+  }
+
+  return LCD_SUCCESS;
+}  // lcd_show_strips
+
+/* -------------------------- swap chain -------------------------- */
+// hands the queued buffer to the bus (called with interrupts disabled)
+void lcd_swap_start_queued(lcd_swapchain_t* sc) {
+  int8_t h = sc->queued;
+
+  sc->queued = -1;
+  sc->scanout = h;
+  sc->state[h] = LCD_BUF_SCANOUT;
+
+  // the checksum taken by lcd_swap_present belongs to this frame
+  bool static_valid = lcd_static_valid;
+
+  lcd_start_frame((void*) sc->buf[h].data, lcd_scr_width * (lcd_depth / 8));
+
+  lcd_static_valid = static_valid;
+}  // lcd_swap_start_queued
+
+void lcd_swap_release(lcd_swapchain_t* sc, int8_t h) {
+  sc->state[h] = LCD_BUF_FREE;
+
+  if (sc->callback != NULL)
+    sc->callback(sc->buf[h], sc->fence[h]);
+}  // lcd_swap_release
+
+// called by the DMA ISR after the last transfer of a frame
+void lcd_frame_done() {
+  lcd_frame_active = false;
+
+  if (lcd_frame_callback != NULL)
+    lcd_frame_callback();
+
+  lcd_swapchain_t* sc = lcd_swap_active;
+
+  if (sc == NULL || sc->scanout < 0)
+    return;
+
+  int8_t h = sc->scanout;
+  sc->scanout = -1;
+  sc->fence_done = sc->fence[h];
+  lcd_swap_release(sc, h);
+
+  // without vsync the next frame follows immediately
+  if (!sc->vsync && sc->queued >= 0)
+    lcd_swap_start_queued(sc);
+}  // lcd_frame_done
+
+// rising edge on the TE pin: the controller has entered vblank
+void lcd_te_handler() {
+  lcd_swapchain_t* sc = lcd_swap_active;
+
+  // if the previous frame is still on the bus, the flip is deferred to
+  // the next vblank
+  if (sc != NULL && sc->queued >= 0 && !lcd_frame_active)
+    lcd_swap_start_queued(sc);
+
+  __sev();
+}  // lcd_te_handler
+
+// waits until all frames of the active swap chain have been sent and
+// releases the bus
+void lcd_swap_detach() {
+  lcd_swapchain_t* sc = lcd_swap_active;
+
+  if (sc == NULL)
+    return;
+
+  while (sc->queued >= 0 || sc->scanout >= 0)
+    lcd_wait_event();
+  lcd_wait_ready();
+
+  if (sc->vsync) {
+    detachInterrupt(digitalPinToInterrupt(PIN_LCD_TE));
+    lcd_disable_te();
+    lcd_window_full = false;
+  }
+
+  lcd_swap_active = NULL;
+}  // lcd_swap_detach
+
+lcd_error_t lcd_swap_init(lcd_swapchain_t* sc, uint8_t num_bufs, bool vsync) {
+  if (!lcd_init_complete)
+    return LCD_NOT_INIT;
+
+  // the buffers are of the compile time type gbuffer_t
+  if (lcd_depth != LCD_COLORDEPTH)
+    return LCD_NOT_SUPPORTED;
+
+  if (num_bufs < 2)
+    num_bufs = 2;
+
+  if (num_bufs > LCD_SWAP_MAX_BUFS)
+    num_bufs = LCD_SWAP_MAX_BUFS;
+
+  for (int h = 0; h < num_bufs; h++) {
+    if (gbuf_alloc(&sc->buf[h], lcd_scr_width, lcd_scr_height) != BUF_SUCCESS) {
+      for (int i = 0; i < h; i++)
+        gbuf_free(sc->buf[i]);
+      return LCD_NO_RAM;
+    }
+    sc->state[h] = LCD_BUF_FREE;
+    sc->fence[h] = 0;
+  }
+
+  sc->num_bufs = num_bufs;
+  sc->back = -1;
+  sc->queued = -1;
+  sc->scanout = -1;
+  sc->next_fence = 1;
+  sc->fence_done = 0;
+  sc->vsync = vsync;
+  sc->callback = NULL;
+
+  // only one swap chain can own the bus
+  lcd_swap_detach();
+  lcd_wait_ready();
+
+  if (vsync) {
+    // TEON ends the memory write, the first frame sets the window again
+    lcd_enable_te();
+    lcd_window_full = false;
+    attachInterrupt(digitalPinToInterrupt(PIN_LCD_TE), lcd_te_handler, RISING);
+  }
+
+  lcd_swap_active = sc;
+
+  return LCD_SUCCESS;
+}  // lcd_swap_init
+
+void lcd_swap_free(lcd_swapchain_t* sc) {
+  if (sc == lcd_swap_active)
+    lcd_swap_detach();
+
+  for (int h = 0; h < sc->num_bufs; h++)
+    gbuf_free(sc->buf[h]);
+
+  sc->num_bufs = 0;
+}  // lcd_swap_free
+
+void lcd_swap_set_callback(lcd_swapchain_t* sc, lcd_release_cb_t callback) {
+  sc->callback = callback;
+}  // lcd_swap_set_callback
+
+gbuffer_t lcd_swap_get_back(lcd_swapchain_t* sc) {
+  if (sc->back >= 0)
+    return sc->buf[sc->back];
+
+  // buffers are only ever freed by the ISR, so wait for one
+  while (true) {
+    for (int h = 0; h < sc->num_bufs; h++) {
+      if (sc->state[h] == LCD_BUF_FREE) {
+        sc->state[h] = LCD_BUF_RENDERING;
+        sc->back = h;
+        return sc->buf[h];
+      }
+    }
+
+    lcd_wait_event();
+  }
+}  // lcd_swap_get_back
+
+uint32_t lcd_swap_present(lcd_swapchain_t* sc) {
+  // The chain has been detached (by lcd_set_mode or another swap chain),
+  // nobody would start the frame. The back buffer is kept.
+  if (sc != lcd_swap_active)
+    return 0;
+
+  // nothing has been rendered since the last present
+  if (sc->back < 0)
+    return sc->next_fence - 1;
+
+  int8_t h = sc->back;
+  uint32_t crc = 0;
+  bool crc_valid = false;
+
+  // Static screens: a frame equal to the previous one is not presented. The
+  // back buffer is kept, as it already holds the next frame.
+  if (lcd_static_active) {
+    crc_valid = lcd_frame_crc((void*) sc->buf[h].data, &crc);
+
+    if (crc_valid && lcd_static_valid && crc == lcd_static_crc)
+      return sc->next_fence - 1;
+  }
+
+  uint32_t fence = sc->next_fence++;
+
+  sc->back = -1;
+  sc->fence[h] = fence;
+
+  uint32_t irq_state = save_and_disable_interrupts();
+
+  // a frame that has not made it to the bus yet is replaced by the newer one
+  if (sc->queued >= 0)
+    lcd_swap_release(sc, sc->queued);
+
+  sc->queued = h;
+  sc->state[h] = LCD_BUF_QUEUED;
+
+  lcd_static_crc = crc;
+  lcd_static_valid = crc_valid;
+
+  // with vsync the transfer is started by the TE handler
+  if (!sc->vsync && !lcd_frame_active)
+    lcd_swap_start_queued(sc);
+
+  restore_interrupts(irq_state);
+
+  return fence;
+}  // lcd_swap_present
+
+bool lcd_swap_fence_reached(lcd_swapchain_t* sc, uint32_t fence) {
+  // frames are sent in order, dropped frames count as reached once a
+  // newer frame has been sent
+  return (int32_t) (sc->fence_done - fence) >= 0;
+}  // lcd_swap_fence_reached
+
+void lcd_swap_wait_fence(lcd_swapchain_t* sc, uint32_t fence) {
+  while (!lcd_swap_fence_reached(sc, fence))
+    lcd_wait_event();
+}  // lcd_swap_wait_fence
 
 void lcd_set_backlight(byte level) {
   pwm_set_gpio_level(PIN_LCD_BL_PWM, level);
@@ -534,22 +2877,26 @@ lcd_error_t lcd_init() {
 
   // configure pin modes
   pinMode(PIN_LCD_RST, OUTPUT);
-  pinMode(PIN_LCD_DC, OUTPUT);
 
   if (lcd_pio_init() != LCD_SUCCESS)
     return LCD_PIO_ERR;
 
   lcd_set_speed(LCD_PIO_SPEED * 1000000);
 
+  // the controller setup already uses command lists
+  if (lcd_dma_init() != LCD_SUCCESS)
+    return LCD_DMA_ERR;
+
   // LCD controller setup (hardware dependent)
   lcd_controller_init();
 
-  if (lcd_dma_init() != LCD_SUCCESS)
-    return LCD_DMA_ERR;
+  lcd_std_palette();
 
-#if defined LCD_DOUBLE_PIXEL_LINEAR || defined LCD_DOUBLE_PIXEL_NEAREST
-  mutex_init(&lcd_scanout_complete);
-#endif
+  // the settings of setup.h are the initial screen mode
+  lcd_error_t err = lcd_apply_mode(LCD_COLORDEPTH, LCD_INIT_FITTER);
+
+  if (err != LCD_SUCCESS)
+    return err;
 
   // setup backlight PWM
   gpio_set_function(PIN_LCD_BL_PWM, GPIO_FUNC_PWM);
@@ -561,10 +2908,6 @@ lcd_error_t lcd_init() {
 
   //lcd_set_backlight(20);
 
-#if LCD_COLORDEPTH == 8
-  lcd_std_palette();
-#endif
-
   lcd_init_complete = true;
 
   return LCD_SUCCESS;
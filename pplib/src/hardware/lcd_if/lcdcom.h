@@ -30,12 +30,17 @@
 typedef enum {
   LCD_SUCCESS = 0,  		/**< @brief Command completed successfully */
   LCD_UNKNOWN_ERROR = -1,   /**< @brief An unknown error occured. */
+  LCD_NO_RAM = -2,          /**< @brief Not enough memory to allocate
+                             * the requested buffers.*/
   LCD_NOT_INIT = -3,   		/**< @brief The LCD interface has not yet
                              * been setup.*/
   LCD_DMA_ERR = -4,			/**< @brief An error has occcured setup up or
                              * using the DMA.*/
-  LCD_PIO_ERR = -5          /**< @brief An error has occcured setup up or
+  LCD_PIO_ERR = -5,         /**< @brief An error has occcured setup up or
                              * using the PIO.*/
+  LCD_NOT_SUPPORTED = -6,   /**< @brief The function is not available
+                             * in the current screen mode.*/
+  LCD_INVALID_PARAM = -7    /**< @brief A parameter is out of range.*/
 } lcd_error_t ; 
 
 /* --------------------- screen mode handling --------------------*/
@@ -59,19 +64,190 @@ typedef enum {
 #endif
 */
 
-#define lcd_get_screen_width() (SCREEN_WIDTH)
-#define lcd_get_screen_height() (SCREEN_HEIGHT)
-#define lcd_get_screen_bpp() (LCD_COLORDEPTH)
+// SCREEN_WIDTH, SCREEN_HEIGHT and LCD_COLORDEPTH describe the screen mode
+// set up by lcd_init. Use lcd_get_screen_width() etc. if the mode is changed
+// at runtime using lcd_set_mode.
+typedef enum {
+  LCD_FITTER_NONE = 0,      /**< @brief one framebuffer pixel per LCD pixel */
+  LCD_FITTER_NEAREST,       /**< @brief pixels doubled (nearest neighbor) */
+  LCD_FITTER_LINEAR,        /**< @brief pixels doubled (linear interpolation) */
+  LCD_FITTER_SCALED         /**< @brief any factor (nearest neighbor, see lcd_set_mode_scaled) */
+} lcd_fitter_t;
+
+/* ---------------------- partial updates ----------------------*/
+// max. number of dirty rectangles handled by a single call of
+// lcd_show_framebuffer_rects (surplus rectangles are merged)
+#define LCD_MAX_RECTS 16
+
+// Cost of opening a new window on the controller (expressed in pixels).
+// Two rectangles are merged if sending the bounding box is cheaper than
+// sending both rectangles individually.
+#define LCD_RECT_OVERHEAD 256
+
+typedef struct {
+  coord_t x1;    /**< @brief upper left corner (inclusive) */
+  coord_t y1;
+  coord_t x2;    /**< @brief lower right corner (inclusive) */
+  coord_t y2;
+} lcd_rect_t;
+
+/* ---------------------- change detection ---------------------*/
+// number of framebuffer lines covered by one checksum
+// (see lcd_show_framebuffer_changed)
+#define LCD_CRC_BAND_HEIGHT 8
+
+/* ------------------------ frame callback ---------------------*/
+// Called (in interrupt context) once the last pixel of a frame has been
+// handed to the PIO. Must not start a transfer.
+typedef void (*lcd_frame_cb_t)(void);
+
+/* ------------------------ strip renderer ---------------------*/
+// number of lines of each of the two strip buffers
+#define LCD_STRIP_HEIGHT 16
+
+// Renders the part of the frame starting at line y_ofs into the strip,
+// i.e. everything needs to be drawn at (x, y - y_ofs).
+typedef void (*lcd_strip_cb_t)(gbuffer_t strip, coord_t y_ofs);
+
+/* ------------------------- swap chain ------------------------*/
+#define LCD_SWAP_MAX_BUFS 3
+
+typedef enum {
+  LCD_BUF_FREE = 0,      /**< @brief may be handed out as back buffer */
+  LCD_BUF_RENDERING,     /**< @brief handed out, being rendered to */
+  LCD_BUF_QUEUED,        /**< @brief presented, waiting for the bus */
+  LCD_BUF_SCANOUT        /**< @brief being sent to the LCD */
+} lcd_buf_state_t;
+
+// Called (in interrupt context) whenever a buffer has been released by the
+// DMA or has been replaced by a newer frame before being sent.
+typedef void (*lcd_release_cb_t)(gbuffer_t buf, uint32_t fence);
+
+typedef struct {
+  gbuffer_t buf[LCD_SWAP_MAX_BUFS];
+  volatile uint8_t state[LCD_SWAP_MAX_BUFS];   /**< @brief lcd_buf_state_t */
+  volatile uint32_t fence[LCD_SWAP_MAX_BUFS];  /**< @brief fence of the frame held */
+  uint8_t num_bufs;
+  int8_t back;                  /**< @brief buffer being rendered (-1 if none) */
+  volatile int8_t queued;       /**< @brief buffer waiting for the bus (-1 if none) */
+  volatile int8_t scanout;      /**< @brief buffer on the bus (-1 if none) */
+  uint32_t next_fence;
+  volatile uint32_t fence_done; /**< @brief last fence that has been sent */
+  bool vsync;                   /**< @brief start transfers on the TE edge */
+  lcd_release_cb_t callback;
+} lcd_swapchain_t;
+
+/* ------------------------ band compositor --------------------*/
+// max. number of bands of a composed frame
+#define LCD_COMP_MAX_BANDS 8
+
+typedef struct {
+  gbuffer_t buf;     /**< @brief source of the band (at least as wide as the screen) */
+  coord_t x;         /**< @brief position of the band within the buffer */
+  coord_t y;
+  coord_t height;    /**< @brief number of screen lines */
+} lcd_comp_band_t;
+
+/* -------------------------- command lists --------------------*/
+// A command list holds command and data bytes (one entry each, including
+// the level of the DC pin), which are sent by a single DMA transfer.
+typedef struct {
+  uint16_t* entries;
+  uint16_t len;
+  uint16_t size;     /**< @brief max. number of entries */
+} lcd_cmdlist_t;
+
+/* ---------------------------- palettes -----------------------*/
+// max. number of palette changes per frame (8 bit mode)
+#define LCD_PAL_MAX_SPLITS 8
+
+typedef struct {
+  coord_t line;                    /**< @brief first framebuffer line using the new entries */
+  uint8_t first;                   /**< @brief first palette entry to be replaced */
+  uint16_t count;                  /**< @brief number of entries to be replaced (up to 256) */
+  const color_palette_t* colors;   /**< @brief the new entries */
+} lcd_pal_split_t;
 
 /* ====================== function declarations ====================== */
 lcd_error_t  lcd_init();
 void lcd_set_speed(uint32_t freq);
 
+/* --------------------------- screen mode --------------------------- */
+lcd_error_t  lcd_set_mode(uint8_t depth, lcd_fitter_t fitter);
+lcd_error_t  lcd_set_mode_scaled(uint8_t depth, uint8_t num, uint8_t den);
+uint16_t     lcd_get_screen_width();
+uint16_t     lcd_get_screen_height();
+uint8_t      lcd_get_screen_bpp();
+lcd_fitter_t lcd_get_fitter();
+
 /* ---------------------- LCD data transmission ---------------------- */
 lcd_error_t  lcd_send_framebuffer(void* buf, uint32_t buffersize);
-lcd_error_t  lcd_show_framebuffer(gbuffer_t buf);
+lcd_error_t  lcd_show_framebuffer(gbuffer8_t buf);
+lcd_error_t  lcd_show_framebuffer(gbuffer16_t buf);
+lcd_error_t  lcd_show_framebuffer(gbuffer_packed_t buf);
+lcd_error_t  lcd_show_framebuffer_view(gbuffer8_t buf, coord_t x, coord_t y);
+lcd_error_t  lcd_show_framebuffer_view(gbuffer16_t buf, coord_t x, coord_t y);
+lcd_error_t  lcd_show_framebuffer_view(gbuffer_packed_t buf, coord_t x, coord_t y);
+lcd_error_t  lcd_show_framebuffer_at(gbuffer8_t buf, coord_t x, coord_t y);
+lcd_error_t  lcd_show_framebuffer_at(gbuffer16_t buf, coord_t x, coord_t y);
+lcd_error_t  lcd_show_framebuffer_at(gbuffer_packed_t buf, coord_t x, coord_t y);
+void         lcd_set_border_color(uint16_t color);
+lcd_error_t  lcd_show_framebuffer_rects(gbuffer8_t buf, lcd_rect_t* rects, uint8_t num_rects);
+lcd_error_t  lcd_show_framebuffer_rects(gbuffer16_t buf, lcd_rect_t* rects, uint8_t num_rects);
+lcd_error_t  lcd_show_framebuffer_interlaced(gbuffer8_t buf);
+lcd_error_t  lcd_show_framebuffer_interlaced(gbuffer16_t buf);
+lcd_error_t  lcd_show_framebuffer_changed(gbuffer8_t buf);
+lcd_error_t  lcd_show_framebuffer_changed(gbuffer16_t buf);
 void lcd_wait_ready();
 int  lcd_check_ready();
+void lcd_set_frame_callback(lcd_frame_cb_t callback);
+
+/* ------------------------- band compositor ------------------------ */
+lcd_error_t lcd_show_composed(const lcd_comp_band_t* bands, uint8_t num_bands);
+
+/* -------------------------- direct drawing ------------------------- */
+// physical coordinates, RGB565 colors (no framebuffer needed)
+lcd_error_t lcd_draw_rect_fill(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint16_t color);
+lcd_error_t lcd_draw_rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2, uint16_t color);
+lcd_error_t lcd_draw_hline(coord_t x1, coord_t x2, coord_t y, uint16_t color);
+lcd_error_t lcd_draw_vline(coord_t x, coord_t y1, coord_t y2, uint16_t color);
+lcd_error_t lcd_draw_buf(coord_t x, coord_t y, gbuffer16_t src);
+lcd_error_t lcd_draw_buf(coord_t x, coord_t y, gbuffer8_t src);
+
+/* ------------------------ vertical scrolling ----------------------- */
+// lines of the controller (see README), fixed areas are not scrolled
+lcd_error_t lcd_scroll_init(uint16_t top, uint16_t bottom);
+lcd_error_t lcd_scroll_to(uint16_t ofs);
+uint16_t    lcd_scroll_line(uint16_t y);
+
+/* -------------------------- static screens ------------------------- */
+// lines of the controller (see README), unchanged frames are not sent
+lcd_error_t lcd_static_begin(uint16_t first, uint16_t last, bool idle);
+lcd_error_t lcd_static_end();
+bool        lcd_static_is_active();
+
+/* -------------------------- strip renderer ------------------------- */
+lcd_error_t lcd_strip_init();
+void        lcd_strip_free();
+lcd_error_t lcd_show_strips(lcd_strip_cb_t render);
+
+/* ---------------------------- swap chain --------------------------- */
+lcd_error_t lcd_swap_init(lcd_swapchain_t* sc, uint8_t num_bufs, bool vsync);
+void        lcd_swap_free(lcd_swapchain_t* sc);
+void        lcd_swap_set_callback(lcd_swapchain_t* sc, lcd_release_cb_t callback);
+gbuffer_t   lcd_swap_get_back(lcd_swapchain_t* sc);
+uint32_t    lcd_swap_present(lcd_swapchain_t* sc);
+bool        lcd_swap_fence_reached(lcd_swapchain_t* sc, uint32_t fence);
+void        lcd_swap_wait_fence(lcd_swapchain_t* sc, uint32_t fence);
+
+/* --------------------------- command lists ------------------------ */
+void        lcd_cmdlist_init(lcd_cmdlist_t* list, uint16_t* buf, uint16_t size);
+void        lcd_cmdlist_cmd(lcd_cmdlist_t* list, uint8_t cmd);
+void        lcd_cmdlist_dat(lcd_cmdlist_t* list, uint8_t dat);
+lcd_error_t lcd_cmdlist_send(lcd_cmdlist_t* list);
+
+lcd_error_t lcd_send_fill(uint16_t color, uint32_t pixels);
+lcd_error_t lcd_fill_screen(uint16_t color);
 
 /* ------------------------ LCD hardware ctrl -------------------------*/
 void lcd_set_backlight(byte level);
@@ -81,10 +257,18 @@ void lcd_set_addr(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void lcd_enable_te();
 void lcd_disable_te();
 bool lcd_get_vblank();
+void lcd_set_scroll_area(uint16_t top, uint16_t height, uint16_t bottom);
+void lcd_set_scroll_start(uint16_t line);
+void lcd_set_partial_area(uint16_t first, uint16_t last);
+void lcd_set_normal_mode();
+void lcd_set_idle(bool idle);
 
-#if LCD_COLORDEPTH == 8
+/* ----------------------------- palettes ----------------------------*/
+// the palette is used in 8 bit mode
 color_palette_t* lcd_get_palette_ptr();
+color_palette_t* lcd_get_back_palette_ptr();
+void lcd_flip_palette();
+lcd_error_t lcd_set_palette_splits(const lcd_pal_split_t* splits, uint8_t num_splits);
 void lcd_std_palette();
-#endif
 
 #endif //LCD_COM_H
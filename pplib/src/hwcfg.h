@@ -23,10 +23,10 @@
 
 // 5 = RC3            (Final version - so I thought)
 // 6 = IPS            (IPS display)
+// 7 = ILI9488        (3.5" 480 x 320 display)
 
-#ifndef PPL_CONFIG_NO
-#define PPL_CONFIG_NO 6
-#endif
+// the configuration is chosen in setup.h
+#include "setup.h"
 
 #if PPL_CONFIG_NO==5
 // ================================== CONFIG 5 ====================================================
@@ -129,6 +129,56 @@
 #define LCD_DRIVER_ST7789
 #include "hardware/lcd_drv/st7789_drv.h"
 
+#elif PPL_CONFIG_NO==7
+// ================================== CONFIG 7 ====================================================
+/*----------------- buttons assignment --------------- */
+#define BUTTON_PULL_MODE INPUT_PULLDOWN
+#define BUTTON_PRESSED HIGH
+
+#define PIN_ANALOG_X  26
+#define PIN_ANALOG_Y  27
+
+#define PIN_BUTTON_1  21
+#define PIN_BUTTON_2  22
+#define PIN_BUTTON_3  20
+
+/* ------------------------ Power management pins ------------------------*/
+#define PIN_BAT_ADC   29
+//#define BAT_PIN_SRC   24
+
+/* ------------------------ Sound assignment ------------------------*/
+#define PIN_SND       0 
+
+/* --------------------------- LCD settings ---------------------------*/
+// LCD_PIO_SPEED defines the PIO speed (in MHz)
+// A 480 x 320 frame has twice the pixels of a 320 x 240 frame, so twice the
+// speed is needed for the same frame rate.
+// Framerate is calculated as follows: approx. 1.6 fps / MHz
+// For a LCD_PIO_SPEED of 66 MHz that means max. 107 fps@66MHz.
+#define LCD_PIO_SPEED 66
+
+/* ------------------------ LCD pin assignment ------------------------*/
+#define PIN_LCD_BL_PWM 14
+
+#define PIN_LCD_TE    2    // tearing pin
+#define PIN_LCD_DC    3    // data/command control pin
+#define PIN_LCD_WR    4    // clock
+#define PIN_LCD_RST   5    // reset pin
+
+// Note: the data pins are PIO hardware configured and
+// driven and need to be in consecutive order
+#define PIN_LCD_D0    6     // 1st of the 8 data pins
+
+// SD pins
+#define PIN_SD_MISO       16
+#define PIN_SD_MOSI       19
+#define PIN_SD_SCK        18
+#define PIN_SD_CS         17
+
+/* ---------------------- TFT driver ----------------------*/
+#define LCD_DRIVER_ILI9488
+#include "hardware/lcd_drv/ili9488_drv.h"
+
 #endif  // CONFIG SELECTION
 
 #endif //HWCFG_H
@@ -21,6 +21,12 @@
 #ifndef SETUP_H
 #define SETUP_H
 
+/* --------------------- hardware configuration ---------------------*/
+// see hwcfg.h (5 = RC3, 6 = IPS, 7 = ILI9488)
+#ifndef PPL_CONFIG_NO
+#define PPL_CONFIG_NO 6
+#endif
+
 /* ------------------------ screen orientatin ------------------------*/
 // 0 = 0° (portrait), 1 = 90° (landscape), 2 = 180° (portrait), 3 = 270° (landscape)
 #define LCD_ROTATION 1
@@ -34,9 +40,33 @@
 
 /* ----------------- pixel doubling / panel fitting -----------------*/
 // please choose 1 or 0 fitters
-//#define LCD_DOUBLE_PIXEL_LINEAR  // works with 16 bit mode only
+//#define LCD_DOUBLE_PIXEL_LINEAR  // occupies core1
 //#define LCD_DOUBLE_PIXEL_NEAREST
 
+// A full resolution 16 bit framebuffer of the ILI9488 (config 7) takes
+// 300 KB, so unless a fitter has been chosen above, the pixels are doubled
+// (240 x 160 framebuffer). With ILI9488_FULL_RES the screen starts in full
+// resolution, which is meant for 8 bit framebuffers (150 KB) or the strip
+// renderer. ILI9488_CROPPED only uses 320 x 240 pixels of the panel.
+//#define ILI9488_FULL_RES
+//#define ILI9488_CROPPED
+#if PPL_CONFIG_NO==7 && !defined ILI9488_FULL_RES && !defined ILI9488_CROPPED
+  #if !defined LCD_DOUBLE_PIXEL_LINEAR && !defined LCD_DOUBLE_PIXEL_NEAREST
+    #define LCD_DOUBLE_PIXEL_NEAREST
+  #endif
+#endif
+
+/* --------------------------- bus format ---------------------------*/
+// Sends 12 bits per pixel (RGB444) instead of 16 bits, which cuts the bus
+// traffic by 25% (ST7789 only). Not available together with
+// LCD_DOUBLE_PIXEL_NEAREST.
+//#define LCD_BUS_RGB444
+
+/* ------------------------- palette lookup -------------------------*/
+// Converts 8 bit frames on core1 into RGB565 lines, which are sent like 16
+// bit frames (frees the lookup state machine and two DMA channels).
+//#define LCD_PALETTE_CORE1  // occupies core1 in 8 bit mode
+
 /* ---------------------- sound output options ----------------------*/
 // Compiles the library with single audio channel support only (no mixing possible)
 // (e.g. when developing an media player which does not require audio channel mixing)
@@ -51,8 +81,8 @@
 #error Please either choose LCD_DOUBLE_PIXEL_LINEAR or LCD_DOUBLE_PIXEL_NEAREST or no panel fitter at all
 #endif
 
-#if defined LCD_DOUBLE_PIXEL_LINEAR && LCD_COLORDEPTH==8
-  #error 8 bpp cannot be combined with linear interpolation panel fitter currently
+#if defined LCD_BUS_RGB444 && defined LCD_DOUBLE_PIXEL_NEAREST
+#error LCD_BUS_RGB444 cannot be combined with LCD_DOUBLE_PIXEL_NEAREST
 #endif
 
 #endif //SETUP_H
@@ -40,12 +40,15 @@ typedef uint8_t color8_t;
 #endif
 
 /* ---------------------- graphics buffers ------------------------- */
+// stride: distance from one line to the next in elements of data (pixels,
+// bytes for packed buffers), 0 if the lines follow each other (see gbuf_view())
 typedef struct 
 {
     uint8_t bpp;
     uint16_t width;
 	uint16_t height;
 	color8_t* data;
+	uint16_t stride;
 } gbuffer8_t;
 
 typedef struct
@@ -54,8 +57,20 @@ typedef struct
     uint16_t width;
 	uint16_t height;
 	color16_t* data;
+	uint16_t stride;
 } gbuffer16_t;
 
+// 4, 2 or 1 bit(s) per pixel (palette indices), packed with the first pixel
+// in the most significant bits of a byte, every line starts at a new byte
+typedef struct
+{
+    uint8_t bpp;
+    uint16_t width;
+	uint16_t height;
+	uint8_t* data;
+	uint16_t stride;
+} gbuffer_packed_t;
+
 #if LCD_COLORDEPTH==16
   // 16 bit / 65k colors
   typedef gbuffer16_t gbuffer_t;